@@ -59,6 +59,7 @@ print(f"✓ Reading findings from: {findings_file}")
 
 # Read and parse JSONL
 findings = []
+low_entropy_count = 0
 try:
     with open(findings_file, 'r') as f:
         for line_num, line in enumerate(f, 1):
@@ -70,6 +71,10 @@ try:
             # Parse JSON
             try:
                 finding = json.loads(line)
+                # Kept by the scanner's --keep-low-entropy but most likely a placeholder
+                if finding.get('low_entropy'):
+                    low_entropy_count += 1
+                    continue
                 findings.append(finding)
             except json.JSONDecodeError as e:
                 print(f"✗ Invalid JSON on line {line_num}: {e}")
@@ -80,6 +85,8 @@ except Exception as e:
     exit(1)
 
 print(f"✓ Loaded {len(findings)} findings\n")
+if low_entropy_count:
+    print(f"⊘ Skipped {low_entropy_count} low-entropy findings (removed with the processed entries)\n")
 
 # Group findings by repository
 from collections import defaultdict
@@ -106,7 +113,7 @@ except GithubException as e:
 # Process each repository
 success_count = 0
 failed_count = 0
-skipped_count = 0
+skipped_count = low_entropy_count  # Dropped from the file like other skips
 failed_findings = []  # Keep track of findings that failed
 
 for i, (repo_key, repo_findings) in enumerate(grouped_findings.items(), 1):
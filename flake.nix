@@ -24,6 +24,9 @@
             nlohmann_json
             yaml-cpp
             spdlog
+            re2
+            zlib
+            gbenchmark
 
             # Python for the bot
             python311
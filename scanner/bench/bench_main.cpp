@@ -0,0 +1,332 @@
+// overwatch_bench - throughput of the scanner's hot paths
+//
+// Runs on Google Benchmark, so its flags apply; for results to keep and
+// compare over time use
+//   overwatch_bench --benchmark_format=json --benchmark_out=bench.json
+// ScanContent reports allocs/scan, the heap allocations of one scan; its
+// /arena variants scan with a ScanContext like the scanner's workers.
+// Own flags:
+//   --patterns=<file>        Base pattern set (default: config/patterns.yaml)
+//   --corpus_bytes=<n>       Size of each generated file (default: 1048576)
+//   --secret_density=<x>     Fraction of records holding a secret (default: 0.01)
+
+#include "base64.h"
+#include "corpus.h"
+#include "entropy.h"
+#include "findings_writer.h"
+#include "matcher_engine.h"
+#include "scan_context.h"
+#include "secret_detector.h"
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <unistd.h>
+
+using namespace overwatch;
+
+// Every heap allocation in the process, so scans can report how many they make
+static std::atomic<size_t> heap_allocations{0};
+
+void* operator new(size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Kept out of line: inlined into a new-expression, GCC takes the free() for a mismatched deallocation
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource() allocates through these
+void* operator new(size_t size, std::align_val_t alignment) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = std::max(sizeof(void*), static_cast<size_t>(alignment));
+    void* p = nullptr;
+    if (posix_memalign(&p, align, size == 0 ? 1 : size) == 0) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Settings {
+    std::string patterns_file = OVERWATCH_BENCH_PATTERNS;
+    size_t corpus_bytes = 1024 * 1024;
+    double secret_density = 0.01;
+    fs::path work_dir;
+};
+
+Settings settings;
+
+// Base file plus synthetic patterns; 0 means the base file as is
+const size_t kPatternCounts[] = {0, 64, 256};
+
+const CorpusKind kKinds[] = {CorpusKind::ENV, CorpusKind::JSON, CorpusKind::PLIST};
+
+std::string patternSet(size_t count) {
+    if (count == 0) {
+        return settings.patterns_file;
+    }
+
+    static std::map<size_t, std::string> written;
+    auto it = written.find(count);
+    if (it == written.end()) {
+        std::string path = (settings.work_dir / ("patterns_" + std::to_string(count) + ".yaml")).string();
+        CorpusGenerator::writePatternSet(settings.patterns_file, count, path);
+        it = written.emplace(count, path).first;
+    }
+    return it->second;
+}
+
+// Compiling is measured separately; scans share one detector per engine and pattern set
+const SecretDetector& detector(const std::string& engine, size_t count) {
+    static std::map<std::pair<std::string, size_t>, std::unique_ptr<SecretDetector>> detectors;
+    auto& slot = detectors[{engine, count}];
+    if (!slot) {
+        slot = std::make_unique<SecretDetector>(engine);
+        slot->loadPatterns(patternSet(count));
+    }
+    return *slot;
+}
+
+std::string countLabel(size_t count) {
+    return count == 0 ? "default" : std::to_string(count);
+}
+
+void BM_LoadPatterns(benchmark::State& state, const std::string& engine, size_t count) {
+    std::string path = patternSet(count);
+    size_t loaded = 0;
+
+    for (auto _ : state) {
+        SecretDetector d(engine);
+        d.loadPatterns(path);
+        loaded = d.patterns().size();
+        benchmark::DoNotOptimize(loaded);
+    }
+
+    state.counters["patterns"] = static_cast<double>(loaded);
+}
+
+// With arena, scratch comes from a ScanContext reset after every scan, as a scan worker does
+void BM_ScanContent(benchmark::State& state, const std::string& engine, size_t count, CorpusKind kind,
+                    bool arena) {
+    const SecretDetector& d = detector(engine, count);
+    std::string content = CorpusGenerator(42).generate(kind, settings.corpus_bytes, settings.secret_density);
+    std::string filename = CorpusGenerator::filename(kind);
+    ScanContext context;
+    size_t matches = 0;
+
+    // Warm up the context (and the engines' per-thread scratch) before counting
+    d.scanContent(content, filename, arena ? &context : nullptr);
+    context.reset();
+
+    size_t allocations = heap_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        auto found = d.scanContent(content, filename, arena ? &context : nullptr);
+        matches = found.size();
+        benchmark::DoNotOptimize(found.data());
+        context.reset();
+    }
+    allocations = heap_allocations.load(std::memory_order_relaxed) - allocations;
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(content.size()));
+    state.counters["patterns"] = static_cast<double>(d.patterns().size());
+    state.counters["matches"] = static_cast<double>(matches);
+    state.counters["allocs/scan"] = benchmark::Counter(static_cast<double>(allocations),
+                                                       benchmark::Counter::kAvgIterations);
+}
+
+void BM_Base64Decode(benchmark::State& state) {
+    // Random bytes encoded like the Contents API does: 60-character lines
+    std::mt19937 rng(7);
+    std::string raw(settings.corpus_bytes, '\0');
+    for (auto& c : raw) {
+        c = static_cast<char>(rng());
+    }
+    std::string flat = base64_encode(raw);
+    std::string encoded;
+    for (size_t i = 0; i < flat.size(); i += 60) {
+        encoded.append(flat, i, 60);
+        encoded += '\n';
+    }
+
+    for (auto _ : state) {
+        std::string decoded = base64_decode(encoded, true);
+        benchmark::DoNotOptimize(decoded.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(encoded.size()));
+}
+
+std::vector<Finding> sampleFindings() {
+    // Real matches from a generated file, so field sizes are realistic
+    CorpusGenerator generator(3);
+    std::string content = generator.generate(CorpusKind::ENV, settings.corpus_bytes, 0.2);
+
+    std::vector<Finding> findings;
+    for (auto& match : detector("auto", 0).scanContent(content, ".env")) {
+        std::string name = detector("auto", 0).patterns()[match.pattern_index].name;
+        findings.push_back({"some-owner", "some-repository", "config/.env", name, std::move(match)});
+    }
+    return findings;
+}
+
+void BM_SerializeFindings(benchmark::State& state) {
+    std::vector<Finding> findings = sampleFindings();
+    std::string path = (settings.work_dir / "findings.jsonl").string();
+    fs::remove(path);
+
+    {
+        FindingsWriter writer(path);
+        for (auto _ : state) {
+            for (const auto& finding : findings) {
+                writer.write(finding);
+            }
+        }
+        writer.flush();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(findings.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(fs::file_size(path)));
+    fs::remove(path);
+}
+
+void BM_JsonEscape(benchmark::State& state) {
+    std::vector<Finding> findings = sampleFindings();
+    size_t bytes = 0;
+    for (const auto& finding : findings) {
+        bytes += finding.match.matched_text.size();
+    }
+
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        for (const auto& finding : findings) {
+            FindingsWriter::appendJsonEscaped(out, finding.match.matched_text);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(bytes));
+}
+
+// Secret values of real matches, as the detector's entropy stage scores them
+void BM_ScoreEntropy(benchmark::State& state, bool vector) {
+    std::vector<Finding> findings = sampleFindings();
+    size_t bytes = 0;
+    for (const auto& finding : findings) {
+        bytes += secretValue(finding.match.matched_text).size();
+    }
+
+    for (auto _ : state) {
+        for (const auto& finding : findings) {
+            std::string_view value = secretValue(finding.match.matched_text);
+            EntropyScore score = vector ? scoreEntropy(value) : scoreEntropyScalar(value);
+            benchmark::DoNotOptimize(score);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(findings.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(bytes));
+}
+
+bool parseFlag(const std::string& arg, const std::string& name, std::string& value) {
+    std::string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Our flags; whatever is left is unknown
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+        if (parseFlag(arg, "patterns", value)) {
+            settings.patterns_file = value;
+        } else if (parseFlag(arg, "corpus_bytes", value)) {
+            settings.corpus_bytes = std::stoul(value);
+        } else if (parseFlag(arg, "secret_density", value)) {
+            settings.secret_density = std::stod(value);
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+
+    settings.work_dir = fs::temp_directory_path() / ("overwatch_bench_" + std::to_string(getpid()));
+    fs::create_directories(settings.work_dir);
+
+    benchmark::AddCustomContext("patterns_file", settings.patterns_file);
+    benchmark::AddCustomContext("corpus_bytes", std::to_string(settings.corpus_bytes));
+    benchmark::AddCustomContext("secret_density", std::to_string(settings.secret_density));
+
+    for (const auto& engine : MatcherEngine::available()) {
+        for (size_t count : kPatternCounts) {
+            std::string suffix = engine + "/patterns:" + countLabel(count);
+
+            benchmark::RegisterBenchmark(("LoadPatterns/" + suffix).c_str(), BM_LoadPatterns, engine, count)
+                ->Unit(benchmark::kMillisecond);
+
+            for (CorpusKind kind : kKinds) {
+                std::string name = "ScanContent/" + engine + "/" + CorpusGenerator::name(kind) +
+                                   "/patterns:" + countLabel(count);
+                benchmark::RegisterBenchmark(name.c_str(), BM_ScanContent, engine, count, kind, false)
+                    ->Unit(benchmark::kMillisecond);
+                benchmark::RegisterBenchmark((name + "/arena").c_str(), BM_ScanContent, engine, count, kind, true)
+                    ->Unit(benchmark::kMillisecond);
+            }
+        }
+    }
+
+    benchmark::RegisterBenchmark("Base64Decode", BM_Base64Decode)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("SerializeFindings", BM_SerializeFindings)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("JsonEscape", BM_JsonEscape)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("ScoreEntropy/vector", BM_ScoreEntropy, true)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("ScoreEntropy/scalar", BM_ScoreEntropy, false)->Unit(benchmark::kMicrosecond);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    std::error_code ec;
+    fs::remove_all(settings.work_dir, ec);
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "corpus.h"
+#include <yaml-cpp/yaml.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace overwatch {
+
+namespace {
+
+const char kAlnum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+const char kUpperDigits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+const char kDigits[] = "0123456789";
+const char kTokenChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-";
+const char kLower[] = "abcdefghijklmnopqrstuvwxyz";
+
+} // namespace
+
+CorpusGenerator::CorpusGenerator(uint32_t seed) : rng_(seed) {
+}
+
+const char* CorpusGenerator::filename(CorpusKind kind) {
+    switch (kind) {
+    case CorpusKind::ENV: return ".env";
+    case CorpusKind::JSON: return "config.json";
+    case CorpusKind::PLIST: return "GoogleService-Info.plist";
+    }
+    return "";
+}
+
+const char* CorpusGenerator::name(CorpusKind kind) {
+    switch (kind) {
+    case CorpusKind::ENV: return "env";
+    case CorpusKind::JSON: return "json";
+    case CorpusKind::PLIST: return "plist";
+    }
+    return "";
+}
+
+std::string CorpusGenerator::randomString(size_t length, const char* alphabet) {
+    size_t size = std::char_traits<char>::length(alphabet);
+    std::uniform_int_distribution<size_t> pick(0, size - 1);
+
+    std::string out(length, ' ');
+    for (auto& c : out) {
+        c = alphabet[pick(rng_)];
+    }
+    return out;
+}
+
+std::string CorpusGenerator::randomWord() {
+    return randomString(std::uniform_int_distribution<size_t>(3, 10)(rng_), kLower);
+}
+
+bool CorpusGenerator::coin(double probability) {
+    return std::bernoulli_distribution(probability)(rng_);
+}
+
+std::pair<std::string, std::string> CorpusGenerator::secret() {
+    switch (std::uniform_int_distribution<int>(0, 4)(rng_)) {
+    case 0: return {"GITHUB_TOKEN", "ghp_" + randomString(36, kAlnum)};
+    case 1: return {"AWS_ACCESS_KEY_ID", "AKIA" + randomString(16, kUpperDigits)};
+    case 2: return {"SLACK_BOT_TOKEN", "xoxb-" + randomString(24, kAlnum)};
+    case 3: return {"TELEGRAM_TOKEN", randomString(9, kDigits) + ":" + randomString(35, kTokenChars)};
+    default: return {"api_key", randomString(32, kAlnum)};
+    }
+}
+
+std::string CorpusGenerator::generate(CorpusKind kind, size_t bytes, double secret_density) {
+    std::string out;
+    out.reserve(bytes + 1024);
+
+    switch (kind) {
+    case CorpusKind::ENV:
+        while (out.size() < bytes) {
+            if (coin(secret_density)) {
+                auto [key, value] = secret();
+                // The generic API key pattern wants the value quoted
+                out += key == "api_key" ? "API_KEY=\"" + value + "\"\n" : key + "=" + value + "\n";
+            } else {
+                out += randomWord() + "_" + randomWord() + "=" + randomString(24, kAlnum) + "\n";
+            }
+        }
+        break;
+
+    case CorpusKind::JSON:
+        out += "{\n  \"items\": [\n";
+        for (int id = 0; out.size() < bytes; id++) {
+            out += id ? ",\n" : "";
+            out += "    {\n      \"id\": " + std::to_string(id) + ",\n";
+            out += "      \"name\": \"" + randomWord() + " " + randomWord() + "\",\n";
+            out += "      \"description\": \"" + randomWord() + " " + randomWord() + " " + randomWord() + "\",\n";
+            out += "      \"checksum\": \"" + randomString(40, kAlnum) + "\",\n";
+            if (coin(secret_density)) {
+                auto [key, value] = secret();
+                out += "      \"" + key + "\": \"" + value + "\",\n";
+            }
+            out += "      \"tags\": [\"" + randomWord() + "\", \"" + randomWord() + "\"]\n    }";
+        }
+        out += "\n  ]\n}\n";
+        break;
+
+    case CorpusKind::PLIST:
+        out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" "
+               "\"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+               "<plist version=\"1.0\">\n<dict>\n";
+        while (out.size() < bytes) {
+            if (coin(secret_density)) {
+                auto [key, value] = secret();
+                out += "\t<key>" + key + "</key>\n\t<string>" + value + "</string>\n";
+            } else {
+                out += "\t<key>" + randomWord() + "</key>\n\t<string>" + randomWord() + "." +
+                       randomWord() + "</string>\n";
+            }
+        }
+        out += "</dict>\n</plist>\n";
+        break;
+    }
+
+    return out;
+}
+
+void CorpusGenerator::writePatternSet(const std::string& base_yaml, size_t count, const std::string& path) {
+    YAML::Node base = YAML::LoadFile(base_yaml);
+    if (!base["patterns"]) {
+        throw std::runtime_error("No patterns in " + base_yaml);
+    }
+
+    YAML::Emitter out;
+    out << YAML::BeginMap << YAML::Key << "patterns" << YAML::Value << YAML::BeginSeq;
+
+    size_t written = 0;
+    for (const auto& pattern : base["patterns"]) {
+        if (written == count) {
+            break;
+        }
+        out << pattern;
+        written++;
+    }
+
+    // Vendor tokens: a literal prefix and a fixed alphabet, like most real patterns
+    for (size_t i = 0; written < count; i++, written++) {
+        out << YAML::BeginMap;
+        out << YAML::Key << "name" << YAML::Value << "Vendor Token " + std::to_string(i);
+        out << YAML::Key << "regex" << YAML::Value << "v" + std::to_string(i) + "tk_[A-Za-z0-9]{24,40}";
+        out << YAML::Key << "files" << YAML::Value << YAML::Flow << YAML::BeginSeq << "*" << YAML::EndSeq;
+        out << YAML::EndMap;
+    }
+
+    out << YAML::EndSeq << YAML::EndMap;
+
+    std::ofstream file(path, std::ios::trunc);
+    file << out.c_str() << "\n";
+    if (!file) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+} // namespace overwatch
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace overwatch {
+
+/**
+ * Shapes of synthetic files, after the ones the scanner fetches most
+ */
+enum class CorpusKind {
+    ENV,     // KEY=value lines
+    JSON,    // Large nested config/export document
+    PLIST    // Apple property list (XML)
+};
+
+/**
+ * Deterministic generator of benchmark inputs
+ * Files are filled with plausible non-secret content; each record (a line,
+ * a JSON object, a plist entry) carries a secret that one of the default
+ * patterns matches with probability secret_density.
+ */
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(uint32_t seed = 1);
+
+    /**
+     * Generate a file of about `bytes` bytes
+     * @param kind File shape
+     * @param bytes Target size (the last record may run past it)
+     * @param secret_density Fraction of records that contain a secret (0..1)
+     */
+    std::string generate(CorpusKind kind, size_t bytes, double secret_density);
+
+    /**
+     * File name the detector should see for this kind (patterns dispatch on it)
+     */
+    static const char* filename(CorpusKind kind);
+
+    /**
+     * Short name used in benchmark names ("env", "json", "plist")
+     */
+    static const char* name(CorpusKind kind);
+
+    /**
+     * Write a patterns.yaml with `count` patterns: the base file's patterns
+     * followed by synthetic vendor-token patterns of the same shape
+     * @param base_yaml Path of the real patterns file
+     * @param count Total number of patterns (at least the base file's)
+     * @param path Where to write
+     */
+    static void writePatternSet(const std::string& base_yaml, size_t count, const std::string& path);
+
+private:
+    std::mt19937 rng_;
+
+    std::string randomString(size_t length, const char* alphabet);
+    std::string randomWord();
+    bool coin(double probability);
+
+    // A token one of the default patterns matches, and a key name to store it under
+    std::pair<std::string, std::string> secret();
+};
+
+} // namespace overwatch
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace overwatch {
+
+/**
+ * Path of a key's entry in a directory sharded by hash
+ * Laid out as <dir>/<hash[0..1]>/<hash>, with hash the FNV-1a 64 of the key
+ * in 16 hex digits. Keys that collide share a path, so entries should store
+ * their key and check it on load.
+ */
+std::string hashedPath(const std::string& dir, const std::string& key);
+
+/**
+ * Replace a file so readers see the old contents or the new, never part of a write
+ * write() fills a temporary file beside path, named after the calling process
+ * and thread so concurrent writers - processes sharing a cache directory
+ * included - don't collide, which is then renamed over path.
+ * Missing parent directories are created.
+ * @return false if anything failed; path is left as it was
+ */
+bool writeFileAtomically(const std::string& path, const std::function<void(std::ostream&)>& write);
+
+} // namespace overwatch
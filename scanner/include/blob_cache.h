@@ -0,0 +1,89 @@
+#pragma once
+
+#include "secret_detector.h"
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Scan results of git blobs, keyed by blob SHA
+ * Byte-identical files (forks, templates, tutorial repos) share a SHA, so a
+ * known SHA skips both the download and the scan. An LRU in memory sits in
+ * front of an on-disk store laid out as
+ *   <dir>/<pattern set hash>/<sha[0..1]>/<sha>-<pattern profile>
+ * Results depend on the pattern set and on which patterns apply to the file
+ * name, so both are part of the key. A pattern set directory's mtime is its
+ * last use (refreshed on open and while storing); opening the cache removes
+ * directories of other pattern sets unused for kStaleAfter, so a reverted
+ * pattern change or another process with different patterns keeps its
+ * results. Thread-safe.
+ */
+class BlobCache {
+public:
+    // Other pattern sets' results unused this long are deleted on open
+    static constexpr std::chrono::hours kStaleAfter{24 * 30};
+
+    /**
+     * Open the cache for one pattern set
+     * @param dir Root directory (e.g. data/blob_cache)
+     * @param pattern_set_hash SecretDetector::patternSetHash() of the detector in use
+     * @param memory_entries Results kept in the in-memory LRU
+     */
+    BlobCache(const std::string& dir, uint64_t pattern_set_hash, size_t memory_entries = 4096);
+
+    /**
+     * Pattern set this cache holds results for
+     */
+    uint64_t patternSetHash() const { return pattern_set_hash_; }
+
+    /**
+     * Look up the matches previously found in a blob
+     * @param sha Git blob SHA
+     * @param profile SecretDetector::patternProfile() of the file name
+     * @return Matches (possibly none), or nullopt if the blob was never scanned
+     */
+    std::optional<std::vector<Match>> lookup(const std::string& sha, uint64_t profile);
+
+    /**
+     * Remember the matches found in a blob
+     */
+    void store(const std::string& sha, uint64_t profile, const std::vector<Match>& matches);
+
+    /**
+     * Lookup counters since the cache was opened
+     */
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    using Entry = std::pair<std::string, std::vector<Match>>;
+
+    std::string dir_;                 // <root>/<pattern set hash>
+    uint64_t pattern_set_hash_;
+    size_t memory_entries_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;            // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    std::chrono::steady_clock::time_point touched_;  // When dir_'s mtime was last refreshed
+
+    static bool validSha(const std::string& sha);
+    static std::string hex(uint64_t value);
+    std::string pathFor(const std::string& key) const;
+    void remember(const std::string& key, std::vector<Match> matches);
+    void touch();
+
+    static bool readResult(const std::string& path, std::vector<Match>& matches);
+    static bool writeResult(const std::string& path, const std::vector<Match>& matches);
+};
+
+} // namespace overwatch
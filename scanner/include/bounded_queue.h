@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Thread-safe FIFO with a fixed capacity
+ * Producers block while the queue is full, consumers block while it is empty.
+ * close() wakes everyone: further pushes fail, pops drain what is left.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * Add an item, waiting for space if the queue is full
+     * @return false if the queue was closed (item is dropped)
+     */
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+
+        if (closed_) {
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * Take the oldest item, waiting if the queue is empty
+     * @return nullopt once the queue is closed and fully drained
+     */
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+        if (items_.empty()) {
+            return std::nullopt;
+        }
+
+        T item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return item;
+    }
+
+    /**
+     * Take up to max_items of the oldest items, waiting until at least one is available
+     * @return Empty once the queue is closed and fully drained
+     */
+    std::vector<T> popBatch(size_t max_items) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+        std::vector<T> batch;
+        while (!items_.empty() && batch.size() < max_items) {
+            batch.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        not_full_.notify_all();
+        return batch;
+    }
+
+    /**
+     * Stop accepting items and wake all waiting threads
+     */
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_ = false;
+    std::deque<T> items_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+} // namespace overwatch
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "github_client.h"
+#include "local_directory_source.h"
 #include "secret_detector.h"
 #include "scanner.h"
+#include "blob_cache.h"
+#include "findings_store.h"
 #include "query_bank.h"
-#include <string>
+#include "repo_index.h"
 #include <map>
+#include <memory>
+#include <string>
 
 namespace overwatch {
 
@@ -19,15 +24,19 @@ enum class Command {
     ALL,
     RANDOM,
     CONTINUOUS,
+    DAEMON,
     FILTER,
     LIST,
+    SCAN_DIR,
+    PATTERNS,
+    FINDINGS,
     HELP,
     UNKNOWN
 };
 
 /**
  * Command-line interface for the scanner
- * Handles different commands: run, add, delete, all, random, filter
+ * Handles different commands: run, add, delete, all, random, filter, scan-dir
  */
 class CLI {
 public:
@@ -50,6 +59,9 @@ private:
     Command command_;  // Parsed command enum
     std::map<std::string, std::string> options_;  // --tag, --name, etc.
     std::vector<std::string> positional_args_;    // Non-flag arguments
+    std::unique_ptr<RepoIndex> scanned_index_;    // Already scanned repositories, see scannedIndex()
+    std::unique_ptr<BlobCache> blob_cache_;       // Results of scanned blobs, see blobCache()
+    std::unique_ptr<FindingsSink> findings_sink_; // Where scans write findings, see findingsSink()
 
     // Helper to convert string to enum
     Command stringToCommand(const std::string& cmd);
@@ -61,13 +73,38 @@ private:
     int allCommand();
     int randomCommand();
     int continuousCommand();
+    int daemonCommand();
     int filterCommand();
     int listCommand();
+    int scanDirCommand();
+    int patternsCommand();
+    int findingsCommand();
 
     // Helpers
     void showHelp();
-    void runScan(const Query& query);
-    void runScanNoValidate(const Query& query, const std::string& token, SecretDetector& detector);
+    // Random bank queries until SIGTERM/SIGINT; reload: pick up edits to patterns and bank
+    int scanForever(bool reload);
+    ScanConfig scanConfig();
+    FindingsWriterConfig outputConfig();
+    // data/findings.jsonl, or the data/findings store with --store
+    FindingsSink& findingsSink();
+    std::string matcherEngine();
+    static std::string yieldSummary(const Query& query);
+    void configureDetector(SecretDetector& detector);
+    RepoIndex& scannedIndex();
+    void configureClient(GitHubClient& client);
+    // Client with tokens validated and quota checked (throws on an invalid token)
+    std::unique_ptr<GitHubClient> connect();
+    ScanConfig effectiveConfig(const Query& query);
+    // incremental: set when the query continues from its bank cursor
+    ScanJob scanJob(const Query& query, QueryBank* bank, bool& incremental);
+    BlobCache* blobCache(const SecretDetector& detector);
+    // bank: where a bank query's cursor is recorded (nullptr for ad-hoc queries)
+    void runScan(const Query& query, QueryBank* bank = nullptr);
+    // Queries of a bank, sharing one client, detector and worker pool
+    void runBatch(const std::vector<Query>& queries, QueryBank& bank);
+    void runScanNoValidate(const Query& query, GitHubClient& client, SecretDetector& detector,
+                           QueryBank* bank = nullptr);
 };
 
 } // namespace overwatch
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace overwatch {
+
+/**
+ * How random a candidate secret looks
+ */
+struct EntropyScore {
+    float entropy = 0;       // Shannon entropy in bits per character
+    uint32_t length = 0;     // Characters scored
+    uint32_t distinct = 0;   // Different byte values
+    uint32_t lower = 0;      // a-z
+    uint32_t upper = 0;      // A-Z
+    uint32_t digits = 0;     // 0-9
+    uint32_t other = 0;      // Everything else
+
+    /**
+     * Number of the four character classes that occur (0-4)
+     */
+    int classes() const { return (lower > 0) + (upper > 0) + (digits > 0) + (other > 0); }
+};
+
+/**
+ * Score text by Shannon entropy and character classes
+ * Strings up to kMaxVectorEntropyLength bytes - every real token - are scored
+ * with SSE2: each byte is broadcast and compared against the whole string
+ * 16 lanes at a time, so its count comes out of a popcount instead of a
+ * table, and the entropy is summed per position (sum of -log2(count / n)).
+ * Longer text, and targets without SSE2, go through scoreEntropyScalar().
+ */
+EntropyScore scoreEntropy(std::string_view text);
+
+/**
+ * Same score from a byte histogram (four interleaved tables, merged at the end)
+ */
+EntropyScore scoreEntropyScalar(std::string_view text);
+
+/**
+ * The part of a match that holds the secret itself
+ * The longest run of bytes without whitespace, quotes or : = , ; - so the
+ * quoted value of "api_key = '...'" rather than the key name around it.
+ */
+std::string_view secretValue(std::string_view match);
+
+// Longest text the vector kernel scores; its cost grows with the square of the
+// length, and past this the histogram is faster
+constexpr size_t kMaxVectorEntropyLength = 128;
+
+} // namespace overwatch
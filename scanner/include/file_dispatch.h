@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Filename to pattern dispatch index built from the patterns' files: lists
+ * Globs fall into three buckets: "*" (every file), "*<suffix>" (e.g. *.env,
+ * kept in a reversed-suffix trie) and exact names (hash map). Resolving a
+ * filename walks the trie once and unions the buckets; the result is cached
+ * per filename, so repeated names cost a single hash lookup.
+ * Lookups are thread-safe; add() and clear() must not race with them.
+ */
+class FileDispatch {
+public:
+    /**
+     * Patterns that apply to one filename
+     */
+    struct Entry {
+        std::vector<size_t> patterns;   // Ascending pattern indices
+        bool targeted = false;          // Named by an exact or suffix glob (not just "*")
+        uint64_t signature = 0;         // Hash of patterns; equal lists have equal signatures
+    };
+
+    FileDispatch();
+
+    /**
+     * Register a pattern's file globs
+     * @param pattern Pattern index reported by lookup()
+     * @param globs Entries from the pattern's files: list
+     */
+    void add(size_t pattern, const std::vector<std::string>& globs);
+
+    /**
+     * Drop every registered pattern and cached result
+     */
+    void clear();
+
+    /**
+     * Resolve a base filename (no directories)
+     * @return Cached entry; stays valid until add() or clear()
+     */
+    const Entry& lookup(std::string_view filename) const;
+
+private:
+    // Cached names before the filename cache is reset (entries are interned separately)
+    static constexpr size_t kMaxCachedNames = 65536;
+
+    struct TrieNode {
+        std::vector<std::pair<char, uint32_t>> children;
+        std::vector<size_t> patterns;   // Patterns whose suffix ends at this node
+    };
+
+    std::vector<size_t> wildcard_;
+    std::unordered_map<std::string, std::vector<size_t>> exact_;
+    std::vector<TrieNode> suffixes_;    // Node 0 is the root
+
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::string, const Entry*> by_name_;
+    mutable std::deque<Entry> entries_;  // Interned results; deque keeps references stable
+
+    void addSuffix(std::string_view suffix, size_t pattern);
+    Entry resolve(std::string_view filename) const;
+    const Entry* intern(Entry entry) const;
+};
+
+} // namespace overwatch
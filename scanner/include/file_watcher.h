@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Calls back when files change on disk
+ * The parent directory of each file is watched (inotify on Linux, modification
+ * times polled elsewhere), so files replaced through a rename - the way editors
+ * and deploy tools save them - are seen as well as writes in place. Events for
+ * one file are coalesced until it has been quiet for a moment, and callbacks run
+ * one at a time on the watcher's own thread.
+ */
+class FileWatcher {
+public:
+    struct Watch {
+        std::string path;
+        std::function<void()> on_change;
+    };
+
+    /**
+     * Start watching
+     * Throws std::runtime_error if a file's directory cannot be watched.
+     */
+    explicit FileWatcher(std::vector<Watch> watches);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+private:
+    struct Entry {
+        Watch watch;
+        std::string directory;
+        std::string filename;
+        int descriptor = -1;                      // inotify watch on directory
+        std::filesystem::file_time_type mtime{};  // Polling fallback
+        bool pending = false;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    // Quiet time after the last event before a callback runs
+    static constexpr std::chrono::milliseconds kSettle{300};
+
+    std::vector<Entry> entries_;
+    int fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+
+    void run();
+    void collectEvents();
+};
+
+} // namespace overwatch
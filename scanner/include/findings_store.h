@@ -0,0 +1,151 @@
+#pragma once
+
+#include "findings_writer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * One finding read back from a FindingsStore
+ */
+struct StoredFinding {
+    uint64_t sequence;   // Position in the log, from 0, never reused
+    std::string json;    // The finding as FindingsWriter writes it (one object, no newline)
+};
+
+/**
+ * Append-only findings log handed from the scanner to its consumers
+ * A directory (e.g. data/findings) of segments named after the sequence of
+ * their first record: <base>.log holds length-prefixed, CRC-checked records
+ * and <base>.idx the offset of each, so reading from any sequence is two
+ * seeks. A consumer records how far it got in the cursor file; compact()
+ * deletes segments that lie entirely before it. Every finding ever stored
+ * leaves a 64-bit hash of (owner, repo, file, secret) in the keys file, so
+ * one found again - in this process or any other - is dropped rather than
+ * re-emitted, even after its segment was compacted away.
+ *
+ * Writers take an exclusive flock on <dir>/lock for each batch, so several
+ * scanner processes can append to one store; readers never block writers.
+ * Records are written before their index entries, so a reader never sees a
+ * half-written record. Numbers are in host byte order.
+ */
+class FindingsStore : public FindingsSink {
+public:
+    /**
+     * Open the store, creating the directory if needed
+     * Batching and fsync follow config like FindingsWriter.
+     * Throws std::runtime_error if the directory cannot be created or locked.
+     */
+    explicit FindingsStore(const std::string& dir, const FindingsWriterConfig& config = FindingsWriterConfig());
+
+    /**
+     * Flush remaining findings
+     */
+    ~FindingsStore() override;
+
+    FindingsStore(const FindingsStore&) = delete;
+    FindingsStore& operator=(const FindingsStore&) = delete;
+
+    /**
+     * Queue one finding, unless one with the same key was stored before
+     * @return false if it was dropped (one another process stores meanwhile is
+     *         dropped when the batch is appended, after this returned true)
+     */
+    bool write(const Finding& finding) override;
+
+    /**
+     * Append queued findings now (and fsync unless the policy is NEVER)
+     */
+    void flush() override;
+
+    /**
+     * Findings queued so far, and those dropped as duplicates
+     */
+    size_t written() const;
+    size_t duplicates() const;
+
+    /**
+     * Stored findings from sequence from on (or the oldest retained one), at most max
+     */
+    std::vector<StoredFinding> read(uint64_t from, size_t max = SIZE_MAX) const;
+
+    /**
+     * Sequence the next stored finding will get
+     */
+    uint64_t endSequence() const;
+
+    /**
+     * First sequence the consumer has not processed (0 before any acknowledge())
+     */
+    uint64_t cursor() const;
+
+    /**
+     * Mark every finding before next as processed (the cursor never moves back)
+     */
+    void acknowledge(uint64_t next);
+
+    /**
+     * Delete segments whose findings are all before the cursor
+     * The segment being appended to is always kept.
+     * @return Number of segments deleted
+     */
+    size_t compact();
+
+    /**
+     * Number of segments on disk
+     */
+    size_t segments() const;
+
+    /**
+     * Dedup key: FNV-1a 64 of owner, repo, file and the matched secret
+     */
+    static uint64_t findingKey(const Finding& finding);
+
+    // Appends roll over to a new segment once the current one is this big
+    static constexpr uint64_t kSegmentBytes = 16 * 1024 * 1024;
+
+private:
+    struct Pending {
+        uint64_t key;
+        std::string json;
+    };
+
+    struct Segment {
+        uint64_t base;   // Sequence of its first record
+        std::string log;
+        std::string idx;
+    };
+
+    std::string dir_;
+    FindingsWriterConfig config_;
+    int lock_fd_ = -1;
+    int keys_fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Pending> pending_;
+    size_t pending_bytes_ = 0;
+    std::unordered_set<uint64_t> seen_;   // Keys stored or queued
+    uint64_t keys_read_ = 0;              // Bytes of the keys file folded into seen_
+    size_t count_ = 0;
+    size_t duplicates_ = 0;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    void flushLocked();
+    // Keys appended since the last call (by us or another process), added to seen_
+    std::vector<uint64_t> catchUpKeysLocked();
+    std::vector<Segment> listSegments() const;
+    Segment segmentAt(uint64_t base) const;
+    // Records in a segment with a complete index entry
+    static uint64_t indexedRecords(const Segment& segment);
+    void appendToSegment(const Segment& segment, const std::vector<const Pending*>& batch);
+};
+
+} // namespace overwatch
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "secret_detector.h"
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace overwatch {
+
+/**
+ * A match located in a specific repository file
+ */
+struct Finding {
+    std::string owner;
+    std::string repo;
+    std::string file;
+    std::string secret_type;   // Name of the pattern that matched
+    Match match;
+};
+
+/**
+ * When the findings file is fsync'ed
+ */
+enum class FsyncPolicy {
+    NEVER,   // Leave it to the OS (survives a crash of the scanner, not of the machine)
+    FLUSH,   // After every batch written
+    ALWAYS   // After every finding; each write() goes straight to disk
+};
+
+/**
+ * Tunables for the findings sink
+ */
+struct FindingsWriterConfig {
+    size_t buffer_bytes = 64 * 1024;  // Batch size that triggers a write
+    int flush_interval_ms = 1000;     // Longest a finding waits in memory
+    FsyncPolicy fsync = FsyncPolicy::NEVER;
+};
+
+/**
+ * Where a scan's findings go (FindingsWriter, FindingsStore)
+ * Implementations are safe to share between threads.
+ */
+class FindingsSink {
+public:
+    virtual ~FindingsSink() = default;
+
+    /**
+     * Queue one finding
+     * @return false if it was dropped as a duplicate of one written before
+     */
+    virtual bool write(const Finding& finding) = 0;
+
+    /**
+     * Write queued findings now
+     */
+    virtual void flush() = 0;
+};
+
+/**
+ * Append-only JSONL sink for findings
+ * Keeps one handle open for its lifetime and batches lines in memory; the
+ * batch is written when it outgrows buffer_bytes, every flush_interval_ms
+ * (background thread) and on destruction. A failed write keeps what was not
+ * written for the next flush. Safe to share between threads.
+ */
+class FindingsWriter : public FindingsSink {
+public:
+    /**
+     * Open (creating if needed) the output file for appending
+     * Throws std::runtime_error if it cannot be opened.
+     */
+    FindingsWriter(const std::string& path, const FindingsWriterConfig& config = FindingsWriterConfig());
+
+    /**
+     * Flush remaining findings and close the file
+     */
+    ~FindingsWriter();
+
+    FindingsWriter(const FindingsWriter&) = delete;
+    FindingsWriter& operator=(const FindingsWriter&) = delete;
+
+    /**
+     * Queue one finding as a JSON line
+     */
+    bool write(const Finding& finding) override;
+
+    /**
+     * Write buffered findings now (and fsync unless the policy is NEVER)
+     */
+    void flush() override;
+
+    /**
+     * Number of findings accepted so far
+     */
+    size_t written() const;
+
+    /**
+     * Parse a policy name: "never", "flush", "always"
+     * Throws std::runtime_error on anything else.
+     */
+    static FsyncPolicy parseFsyncPolicy(const std::string& name);
+
+    /**
+     * Append text to out as the contents of a JSON string (no quotes)
+     * Invalid UTF-8 bytes become U+FFFD so every line stays valid JSON.
+     */
+    static void appendJsonEscaped(std::string& out, std::string_view text);
+
+    /**
+     * Append a finding to out as one JSON object (no trailing newline)
+     * @param timestamp When it was found, "YYYY-MM-DDTHH:MM:SSZ"
+     */
+    static void appendJson(std::string& out, const Finding& finding, const char* timestamp);
+
+private:
+    std::string path_;
+    FindingsWriterConfig config_;
+    int fd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::string buffer_;
+    size_t count_ = 0;
+    bool stopping_ = false;
+    std::thread flusher_;
+
+    // "YYYY-MM-DDTHH:MM:SSZ", recomputed at most once per second
+    std::time_t stamp_second_ = 0;
+    char stamp_[21] = {};
+
+    void flushLocked();
+    const char* timestampLocked();
+};
+
+} // namespace overwatch
@@ -1,27 +1,31 @@
 #pragma once
 
+#include "http_cache.h"
+#include "http_fixtures.h"
+#include "rate_limiter.h"
+#include "repo_source.h"
+#include "tarball_reader.h"
+#include "token_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
+#include <optional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
 
 namespace overwatch {
 
-/**
- * Represents a GitHub repository
- */
-struct Repository {
-    std::string owner;
-    std::string name;
-    std::string url;
-    int stars;
-    std::string language;
-    bool archived;
-};
-
 /**
  * GitHub API client for making authenticated requests
+ * Requests run on pooled cpr::Sessions with prebuilt headers, so connections
+ * stay open for the client's lifetime - keep one client around for many scans.
  */
-class GitHubClient {
+class GitHubClient : public RepoSource {
 public:
     /**
      * Constructor: Create a GitHub client
@@ -30,13 +34,20 @@ public:
     explicit GitHubClient(const std::string& token);
 
     /**
-     * Validate that the token is working
-     * @return true if token is valid, false otherwise
+     * Constructor: Create a GitHub client that spreads requests over several tokens
+     * @param tokens GitHub API tokens (empty list for unauthenticated)
+     */
+    explicit GitHubClient(const std::vector<std::string>& tokens);
+
+    /**
+     * Validate that the tokens are working
+     * Invalid tokens are dropped from the pool as long as one valid token remains.
+     * @return true if at least one token is valid, false otherwise
      */
     bool validateToken();
 
     /**
-     * Get current rate limit status
+     * Get current rate limit status (limits and remaining summed over all tokens)
      * @return JSON object with rate limit info
      */
     nlohmann::json getRateLimit();
@@ -45,9 +56,28 @@ public:
      * Search for repositories on GitHub
      * @param query Search query (e.g., "language:Python stars:<10")
      * @param max_results Maximum number of repositories to return
+     * @param options Sort order of the results
      * @return Vector of Repository objects
      */
-    std::vector<Repository> searchRepositories(const std::string& query, int max_results = 30);
+    std::vector<Repository> searchRepositories(const std::string& query, int max_results = 30,
+                                               const SearchOptions& options = SearchOptions());
+
+    /**
+     * Stream search results page by page
+     * on_page runs for each page as soon as it arrives, while the next page is
+     * already being fetched, so only about two pages are held at a time.
+     * GitHub serves at most 1000 results per query; when more are wanted and the
+     * query matches more, it is split into created: windows (halved until each
+     * fits) searched by options.shard_workers threads. on_page is never called
+     * concurrently, and the pages of different windows arrive in no set order.
+     * @param query Search query
+     * @param max_results Maximum number of repositories (0 = all)
+     * @param options Sort order of the results
+     * @param on_page Called with each page; return false to stop
+     * @return Number of repositories delivered
+     */
+    int searchRepositoriesPaged(const std::string& query, int max_results, const SearchOptions& options,
+                                const std::function<bool(SearchPage&)>& on_page) override;
 
     /**
      * Get file contents from a repository
@@ -58,9 +88,172 @@ public:
      */
     std::string getFileContent(const std::string& owner, const std::string& repo, const std::string& path);
 
+    /**
+     * Fetch several files from one repository concurrently
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param paths File paths within repository
+     * @param max_in_flight Maximum number of requests in flight at once
+     * @return Decoded contents in the same order as paths (nullopt if missing)
+     */
+    std::vector<std::optional<FileContent>> getFileContents(const std::string& owner, const std::string& repo,
+                                                            const std::vector<std::string>& paths,
+                                                            int max_in_flight) override;
+
+    /**
+     * Fetch files of many repositories with a few GraphQL queries
+     * Each query aliases one repository(...) field per repo and one
+     * object(expression: "<ref>:<path>") per file, so dozens of files cost a
+     * single request and their text comes back inline, without base64.
+     * Binary and oversized blobs (no inline text), and every file when no token
+     * is configured (GraphQL requires one), go through the contents API instead.
+     * @param requests Files to fetch, from any number of repositories
+     * @param max_in_flight Contents API requests open at once for the files that fall back
+     * @return Contents in request order (nullopt where the file doesn't exist or failed)
+     */
+    std::vector<std::optional<FileContent>> batchGetFiles(const std::vector<FileRequest>& requests,
+                                                          int max_in_flight) override;
+
+    /**
+     * List a repository's files with the Git Trees API
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param ref Branch, tag or tree SHA (e.g. "HEAD")
+     * @param recursive Include entries from all subdirectories
+     * @return Tree entries (empty for an empty repository)
+     */
+    RepositoryTree getTree(const std::string& owner, const std::string& repo,
+                           const std::string& ref, bool recursive = true) override;
+
+    /**
+     * Download a repository archive and stream it through a reader
+     * The gzipped tarball is inflated and untarred as it arrives, nothing is
+     * written to disk, and the whole download costs one core API request.
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param ref Branch, tag or commit SHA (e.g. "HEAD")
+     * @param reader Receives the archive bytes
+     * @return true if the whole archive was read
+     */
+    bool streamTarball(const std::string& owner, const std::string& repo,
+                       const std::string& ref, TarballReader& reader) override;
+
+    /**
+     * Tokens (and their quota state) this client sends requests with
+     */
+    TokenPool& tokenPool() { return pool_; }
+
+    /**
+     * Requests sent so far that count against the rate limit
+     * (replayed ones included, 304 revalidations and failed transfers not)
+     */
+    uint64_t requestsSent() const { return requests_sent_.load(); }
+
+    /**
+     * Revalidate search and contents responses against an on-disk cache
+     * Requests carry If-None-Match / If-Modified-Since from the cached copy;
+     * a 304 reply is free of rate limit and is served from the cache as a 200.
+     * @param dir Cache directory (e.g. data/http_cache)
+     * @param max_bytes Size the cache is evicted down to, least recently used first
+     */
+    void enableHttpCache(const std::string& dir, uint64_t max_bytes = HttpCache::kDefaultMaxBytes);
+
+    /**
+     * Save every response received to a fixture directory
+     * The fixtures let replayFixtures() rerun the same scan without a network.
+     * @param dir Fixture directory (e.g. data/fixtures)
+     */
+    void recordFixtures(const std::string& dir);
+
+    /**
+     * Answer every request from a fixture directory instead of the network
+     * Requests with no recorded response get a 404; rate limits are not
+     * applied, so a replay runs as fast as parsing and scanning allow.
+     * @param dir Fixture directory written by recordFixtures()
+     */
+    void replayFixtures(const std::string& dir);
+
 private:
-    std::string token_;
+    TokenPool pool_;
     std::string base_url_;
+
+    // Retries for 403/429 rate limit responses before giving up
+    static constexpr int kMaxRateLimitRetries = 5;
+
+    // Files per GraphQL query; keeps responses (whole file texts) to a sensible size
+    static constexpr size_t kMaxGraphqlObjects = 50;
+
+    // Search API limits: results reachable per query, and page size
+    static constexpr int kMaxSearchResults = 1000;
+    static constexpr int kMaxSearchPerPage = 100;
+
+    // Fetches of a shard's first page before the window is given up
+    static constexpr int kMaxShardAttempts = 3;
+
+    // Start of the first created: window when sharding (2007-10-01, before GitHub's first repositories)
+    static constexpr int64_t kFirstRepositoryCreated = 1191196800;
+
+    // Conditional request cache; nullptr unless enableHttpCache() was called
+    std::unique_ptr<HttpCache> http_cache_;
+
+    // Recorded responses; nullptr unless recordFixtures() or replayFixtures() was called
+    std::unique_ptr<HttpFixtures> fixtures_;
+
+    // Idle keep-alive sessions per token, reused across requests and scans
+    std::map<const TokenState*, std::vector<std::unique_ptr<cpr::Session>>> idle_sessions_;
+    std::mutex sessions_mutex_;
+
+    std::atomic<uint64_t> requests_sent_{0};
+
+    // Count a response and record its latency by endpoint and status
+    void recordRequest(const std::string& url, long status, uint64_t nanos);
+
+    cpr::Header buildHeaders(const TokenState& token) const;
+    std::unique_ptr<cpr::Session> acquireSession(TokenState& token);
+    void releaseSession(TokenState& token, std::unique_ptr<cpr::Session> session);
+
+    // Send one GET on a pooled session (no rate limiting); a non-empty
+    // cache_key makes it a conditional request against http_cache_
+    cpr::Response perform(TokenState& token, const std::string& url,
+                          const cpr::Parameters& parameters = {}, const std::string& cache_key = "");
+
+    /**
+     * Send a GET through the rate limiter of the token with the most headroom
+     * Rate limit headers are recorded from every response, and 403/429
+     * rate limit responses are retried after the server's requested delay.
+     * @param fixed_token Send with this token only instead of picking from the pool
+     * @param cache_key Identifies the request (URL and query) for conditional caching
+     */
+    cpr::Response get(RateResource resource, const std::string& url,
+                      const cpr::Parameters& parameters = {}, TokenState* fixed_token = nullptr,
+                      const std::string& cache_key = "");
+
+    // Page through one query (up to limit results), starting from an already fetched first page
+    int streamSearch(const std::string& query, int limit, const SearchOptions& options,
+                     std::optional<SearchPage> first, const std::function<bool(SearchPage&)>& on_page);
+
+    // Split a query into created: windows that each fit the result cap, searched in parallel
+    int searchSharded(const std::string& query, int max_results, const SearchOptions& options,
+                      const std::function<bool(SearchPage&)>& on_page);
+
+    // POST a GraphQL query; returns its "data" object (nullopt if the request failed)
+    std::optional<nlohmann::json> graphql(const std::string& query);
+
+    // Fetch one search page (nullopt if the request failed)
+    std::optional<SearchPage> fetchSearchPage(const std::string& query, int per_page, int page,
+                                              const SearchOptions& options);
+
+    bool replaying() const { return fixtures_ && fixtures_->mode() == HttpFixtures::Mode::REPLAY; }
+
+    // Wait for the token's bucket (immediately when replaying)
+    void acquire(TokenState& token, RateResource resource);
+
+    // The recorded response to a request (404 if none); key is "<method> <url and query>[ <body>]"
+    cpr::Response replay(const std::string& key, const std::string& url) const;
+    void record(const std::string& key, const cpr::Response& r) const;
+
+    // Record rate limit headers; returns true if the response was a rate limit rejection
+    bool handleRateLimit(TokenState& token, RateResource resource, const cpr::Response& r, int attempt);
 };
 
 } // namespace overwatch
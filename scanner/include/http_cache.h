@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace overwatch {
+
+/**
+ * A response body with the validators GitHub sent for it
+ */
+struct CachedResponse {
+    std::string etag;
+    std::string last_modified;
+    std::string body;
+};
+
+/**
+ * On-disk store of validated responses for conditional requests
+ * Entries live at hashedPath(dir, key), where the key is the URL plus query.
+ * GitHub answers a matching If-None-Match / If-Modified-Since with 304 Not
+ * Modified, which costs no rate limit; the body stored here then stands in
+ * for the response. Thread-safe: entries
+ * are replaced with writeFileAtomically().
+ *
+ * The directory is held to a byte budget. A hit refreshes the entry's mtime,
+ * and once a store takes the total over budget the least recently used
+ * entries are deleted until it is back under three quarters of it.
+ */
+class HttpCache {
+public:
+    static constexpr uint64_t kDefaultMaxBytes = 256ULL << 20;
+
+    /**
+     * @param dir Root directory (e.g. data/http_cache), created if missing
+     * @param max_bytes Budget for the entries under dir
+     */
+    explicit HttpCache(const std::string& dir, uint64_t max_bytes = kDefaultMaxBytes);
+
+    /**
+     * Load the stored response for a request key
+     * @return nullopt if nothing (or a different key with the same hash) is stored
+     */
+    std::optional<CachedResponse> load(const std::string& key) const;
+
+    /**
+     * Store a response that carries an ETag and/or Last-Modified
+     * Bodies larger than the whole budget are not stored.
+     */
+    void store(const std::string& key, const CachedResponse& response);
+
+    /**
+     * Bytes currently held under the cache directory
+     */
+    uint64_t sizeBytes() const { return size_bytes_.load(); }
+
+private:
+    std::string dir_;
+    uint64_t max_bytes_;
+    std::atomic<uint64_t> size_bytes_{0};
+    std::mutex evict_mutex_;
+
+    // Delete least recently used entries until the cache is under the low-water mark
+    void evict();
+};
+
+} // namespace overwatch
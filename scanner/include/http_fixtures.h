@@ -0,0 +1,59 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * One HTTP response as it was received
+ */
+struct RecordedResponse {
+    long status_code = 0;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+/**
+ * Directory of recorded HTTP responses, for network-free replays
+ * A recording run stores each response under its request key (method, URL
+ * and query, plus the body of a POST); a replay run looks them up instead of
+ * sending anything. Files are laid out like HttpCache's, at hashedPath(dir, key).
+ * Responses to repeated requests overwrite each other, so the last one wins.
+ * Thread-safe: entries are replaced with writeFileAtomically().
+ */
+class HttpFixtures {
+public:
+    enum class Mode {
+        RECORD,
+        REPLAY
+    };
+
+    /**
+     * @param dir Fixture directory, created if missing when recording
+     * @param mode Whether responses are stored or served
+     * Throws std::runtime_error when replaying from a directory that doesn't exist.
+     */
+    HttpFixtures(const std::string& dir, Mode mode);
+
+    Mode mode() const { return mode_; }
+
+    /**
+     * Load the response recorded for a request key
+     * @return nullopt if nothing (or a different key with the same hash) was recorded
+     */
+    std::optional<RecordedResponse> load(const std::string& key) const;
+
+    /**
+     * Record a response
+     */
+    void store(const std::string& key, const RecordedResponse& response) const;
+
+private:
+    std::string dir_;
+    Mode mode_;
+};
+
+} // namespace overwatch
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Offsets of each literal in a scanned buffer, by literal id
+ * Inner lists are allocated from the same memory resource as the outer one.
+ */
+using LiteralHits = std::pmr::vector<std::pmr::vector<size_t>>;
+
+/**
+ * Case-insensitive multi-literal search used to skip regex work
+ * Each literal is a substring every match of its pattern must contain
+ * (e.g. "ghp_" for GitHub tokens). One vectorized pass over a buffer
+ * reports where each literal occurs; regexes then only run near hits.
+ */
+class LiteralPrefilter {
+public:
+    // Extracted literals shorter than this are too common to be worth it
+    static constexpr size_t kMinExtractedLength = 3;
+
+    // The SIMD pass fingerprints the first two bytes of every literal
+    static constexpr size_t kMinLiteralLength = 2;
+
+    /**
+     * Find the longest literal that every match of a regex must contain
+     * Only top-level literal runs are considered: groups, classes, escapes
+     * with special meaning and optional atoms end a run, and a top-level
+     * alternation means there is no required literal at all.
+     * @return Lower-cased literal, or "" if none of kMinExtractedLength or more
+     */
+    static std::string extractLiteral(const std::string& regex);
+
+    /**
+     * Register a literal to search for
+     * @return Literal id used in scan() results (identical literals share an id)
+     */
+    size_t add(const std::string& literal);
+
+    /**
+     * Number of distinct literals registered
+     */
+    size_t size() const { return literals_.size(); }
+
+    /**
+     * Find every occurrence of every literal in text
+     * @param hits Resized to size(); hits[id] receives ascending offsets of literal id
+     */
+    void scan(std::string_view text, LiteralHits& hits) const;
+
+private:
+    // First two bytes of a literal, case-folded and broadcast to a SIMD lane each
+    struct Fingerprint {
+        alignas(16) unsigned char first[16];
+        alignas(16) unsigned char second[16];
+    };
+
+    std::vector<std::string> literals_;  // Lower-cased
+    std::vector<Fingerprint> fingerprints_;  // One per literal, built by add()
+
+    bool matchesAt(std::string_view text, size_t offset, const std::string& literal) const;
+    void scanScalar(std::string_view text, size_t from, LiteralHits& hits) const;
+};
+
+} // namespace overwatch
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "repo_source.h"
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Repositories read from a directory on disk instead of GitHub
+ * Either the root itself is one repository (owner "local", named after the
+ * directory), or - with corpus layout - every <root>/<owner>/<repo> directory
+ * is one, the way archived downloads are usually kept. Trees are walked with
+ * several threads and each file is read with one read() into a string of its
+ * size, which is the only copy made. Symbolic links are not followed, and there are
+ * no blob SHAs (the blob cache has nothing to key on).
+ */
+class LocalDirectorySource : public RepoSource {
+public:
+    /**
+     * @param root Directory to serve
+     * @param corpus Treat <root>/<owner>/<repo> directories as repositories
+     * @param walk_threads Threads listing a tree (0 = one per core)
+     * Throws std::runtime_error if root is not a directory.
+     */
+    LocalDirectorySource(const std::string& root, bool corpus, int walk_threads = 0);
+
+    /**
+     * Every repository under the root, in path order (the query is ignored)
+     */
+    int searchRepositoriesPaged(const std::string& query, int max_results, const SearchOptions& options,
+                                const std::function<bool(SearchPage&)>& on_page) override;
+
+    /**
+     * Walk a repository directory (ref is ignored)
+     */
+    RepositoryTree getTree(const std::string& owner, const std::string& repo,
+                           const std::string& ref, bool recursive = true) override;
+
+    /**
+     * Read files, max_in_flight of them at a time
+     */
+    std::vector<std::optional<FileContent>> getFileContents(const std::string& owner, const std::string& repo,
+                                                            const std::vector<std::string>& paths,
+                                                            int max_in_flight) override;
+
+    std::vector<std::optional<FileContent>> batchGetFiles(const std::vector<FileRequest>& requests,
+                                                          int max_in_flight) override;
+
+    /**
+     * Always false: there are no archives, files are read directly
+     */
+    bool streamTarball(const std::string& owner, const std::string& repo,
+                       const std::string& ref, TarballReader& reader) override;
+
+private:
+    std::filesystem::path root_;
+    bool corpus_;
+    int walk_threads_;
+
+    // Repositories per search page
+    static constexpr size_t kPageSize = 100;
+
+    std::filesystem::path repositoryPath(const std::string& owner, const std::string& repo) const;
+    std::vector<Repository> listRepositories() const;
+};
+
+} // namespace overwatch
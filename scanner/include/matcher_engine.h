@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Regex backend used by SecretDetector
+ * An engine compiles every pattern once and answers two questions:
+ * which patterns occur anywhere in a buffer (ideally in a single pass),
+ * and where a given pattern first matches inside a line.
+ * All patterns are case-insensitive, as they have always been.
+ */
+class MatcherEngine {
+public:
+    virtual ~MatcherEngine() = default;
+
+    /**
+     * Engine name as accepted by create() (e.g. "re2", "std")
+     */
+    virtual std::string name() const = 0;
+
+    /**
+     * Whether a search takes time linear in the text, whatever the pattern
+     * Backtracking engines can take exponential time on a long enough line.
+     */
+    virtual bool linearTime() const = 0;
+
+    /**
+     * Compile the pattern set; index i in later calls refers to regexes[i]
+     * Throws std::runtime_error naming the first regex that fails to compile.
+     */
+    virtual void compile(const std::vector<std::string>& regexes) = 0;
+
+    /**
+     * Narrow candidate patterns to those that may match somewhere in text
+     * Single-pass engines return exactly the patterns that hit; engines
+     * without a multi-pattern mode may return candidates unchanged.
+     * @param text Whole file content
+     * @param candidates Pattern indices to consider (ascending)
+     * @param result Subset of candidates is appended, ascending
+     */
+    virtual void matchingPatterns(std::string_view text, const std::pmr::vector<size_t>& candidates,
+                                  std::pmr::vector<size_t>& result) const = 0;
+
+    /**
+     * Find the first match of one pattern in text
+     * @return true and the match span (offset/length into text) if found
+     */
+    virtual bool find(size_t pattern, std::string_view text, size_t& start, size_t& length) const = 0;
+
+    /**
+     * Create an engine by name
+     * "auto" picks the fastest engine compiled in, and falls back to std with
+     * a warning if RE2 rejects a pattern; an explicit "re2" throws instead.
+     * Unknown names throw.
+     */
+    static std::unique_ptr<MatcherEngine> create(const std::string& name);
+
+    /**
+     * Names of the engines compiled into this build
+     */
+    static std::vector<std::string> available();
+};
+
+} // namespace overwatch
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Label name/value pairs that tell series of one metric apart
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * Human-readable duration with a unit suited to its size (e.g. "812ns", "3.41ms")
+ */
+std::string formatDuration(uint64_t nanos);
+
+/**
+ * Monotonic counter; add() is a single relaxed atomic increment
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * Latency histogram with HDR-style log-linear buckets
+ * Nanosecond values fall into power-of-two ranges, each split into 16 linear
+ * sub-buckets, so any quantile is within 1/16 of the true value - from
+ * nanoseconds up to about 18 minutes (larger values land in the last bucket).
+ * record() is a few relaxed atomic operations and never locks.
+ */
+class Histogram {
+public:
+    void record(uint64_t nanos);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    /**
+     * Approximate value at quantile q (0..1), in nanoseconds (0 if empty)
+     */
+    uint64_t quantile(double q) const;
+
+private:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxBits = 40;   // 2^40 ns ~ 18 minutes
+    static constexpr size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+
+    static size_t bucketOf(uint64_t nanos);
+    static uint64_t bucketMidpoint(size_t bucket);
+};
+
+/**
+ * Time from construction to elapsed()
+ */
+class Stopwatch {
+public:
+    Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+
+    uint64_t elapsed() const {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Record the lifetime of a scope into a histogram
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) : histogram_(histogram) {}
+    ~ScopedTimer() { histogram_.record(watch_.elapsed()); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    Stopwatch watch_;
+};
+
+/**
+ * Process-wide set of named counters and histograms
+ * Looking a series up takes a lock; the returned reference stays valid for
+ * the process lifetime, so hot paths look theirs up once and keep it.
+ * Histogram names end in _seconds and are exported in seconds.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    /**
+     * The counter for a name and label set, created on first use
+     * @param help One-line description (used the first time a name is seen)
+     */
+    Counter& counter(const std::string& name, const MetricLabels& labels = {}, const std::string& help = "");
+
+    /**
+     * The histogram for a name and label set, created on first use
+     * @param help One-line description (used the first time a name is seen)
+     */
+    Histogram& histogram(const std::string& name, const MetricLabels& labels = {}, const std::string& help = "");
+
+    /**
+     * Every series in the Prometheus text format (histograms as summaries)
+     */
+    std::string prometheus() const;
+
+    /**
+     * Table of every histogram and counter that saw data
+     */
+    void printSummary(std::ostream& out) const;
+
+private:
+    enum class Kind {
+        COUNTER,
+        HISTOGRAM
+    };
+
+    struct Series {
+        std::string name;
+        MetricLabels labels;
+        Kind kind;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Series>> series_;   // By name{labels}
+    std::map<std::string, std::string> help_;                 // By name
+
+    Series& lookup(const std::string& name, const MetricLabels& labels, const std::string& help, Kind kind);
+};
+
+} // namespace overwatch
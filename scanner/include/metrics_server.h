@@ -0,0 +1,40 @@
+#pragma once
+
+#include "metrics.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace overwatch {
+
+/**
+ * Minimal HTTP endpoint for Prometheus scrapes
+ * A background thread answers GET /metrics with the registry in the text
+ * exposition format, one connection at a time; every other path gets a 404.
+ */
+class MetricsServer {
+public:
+    /**
+     * Start listening
+     * @param registry Metrics to serve
+     * @param address IPv4 address to bind (e.g. "127.0.0.1", or "0.0.0.0" for all interfaces)
+     * @param port TCP port
+     * Throws std::runtime_error if the socket cannot be bound.
+     */
+    MetricsServer(const MetricsRegistry& registry, const std::string& address, int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    const MetricsRegistry& registry_;
+    int fd_ = -1;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+
+    void serve();
+    void handle(int client);
+};
+
+} // namespace overwatch
@@ -1,10 +1,28 @@
 #pragma once
 
+#include <cstdint>
+#include <random>
 #include <string>
 #include <vector>
 
 namespace overwatch {
 
+/**
+ * What runs of a query have returned, exponentially decayed so recent runs count most
+ */
+struct QueryYield {
+    double runs = 0;
+    double requests = 0;    // API calls spent
+    double new_repos = 0;   // Repositories not scanned before
+    double findings = 0;
+
+    /**
+     * New repositories per API call, weighted by 1 + findings per repository
+     * (i.e. (new repos + findings) per call); 0 before the first run
+     */
+    double value() const { return requests > 0 ? (new_repos + findings) / requests : 0; }
+};
+
 /**
  * Represents a single search query
  */
@@ -14,6 +32,9 @@ struct Query {
     std::string query;           // GitHub search query string
     std::vector<std::string> tags;
     int max_repos;
+    std::string cursor;          // Newest pushed_at seen by earlier runs ("" = never run)
+    std::string fetch_mode;      // "auto", "contents" or "tarball" ("" = scanner default)
+    QueryYield yield;            // Scheduling statistics from earlier runs
 };
 
 /**
@@ -25,6 +46,7 @@ public:
 
     /**
      * Load queries from YAML file
+     * Cursors are read from query_state.yaml in the same directory.
      */
     void load(const std::string& yaml_path);
 
@@ -49,10 +71,18 @@ public:
     std::vector<Query> getAllQueries() const;
 
     /**
-     * Get a random query
+     * Get a random query (uniformly)
      */
     Query getRandomQuery() const;
 
+    /**
+     * Pick the query to run next, spending quota where it has paid off
+     * Queries never scored go first; otherwise UCB1 over QueryYield::value()
+     * (scaled so the best query scores 1), except that with probability
+     * kExplorationFloor the pick is uniform so no query starves on old numbers.
+     */
+    Query nextQuery() const;
+
     /**
      * Filter queries by tag
      */
@@ -63,9 +93,43 @@ public:
      */
     int getNextId() const;
 
+    /**
+     * Advance a query's high-water mark and persist it to query_state.yaml
+     * Older timestamps than the stored cursor are ignored.
+     * @param id Query ID
+     * @param pushed_at Newest pushed_at among the repositories the run saw
+     */
+    void recordCursor(int id, const std::string& pushed_at);
+
+    /**
+     * Add one run's outcome to a query's yield and persist it to query_state.yaml
+     * @param new_repos Repositories scanned for the first time
+     * @param findings Findings in them
+     * @param requests API calls the run spent
+     */
+    void recordYield(int id, int new_repos, int findings, uint64_t requests);
+
+    /**
+     * Take cursors and yields over from the bank this one replaces
+     * What load() read from query_state.yaml may predate the previous bank's
+     * last scan; its in-memory state is newer. As with the file, state only
+     * carries over to a query with the same id and query text.
+     */
+    void adoptState(const QueryBank& previous);
+
 private:
+    // Share of picks made uniformly at random by nextQuery()
+    static constexpr double kExplorationFloor = 0.1;
+    // Weight left on a query's earlier runs each time it runs again
+    static constexpr double kYieldDecay = 0.9;
+
     std::vector<Query> queries_;
+    mutable std::mt19937 rng_{std::random_device{}()};
     std::string yaml_path_;
+    std::string state_path_;    // query_state.yaml beside yaml_path_
+
+    void loadState();
+    void saveState();
 };
 
 } // namespace overwatch
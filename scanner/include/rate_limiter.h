@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace overwatch {
+
+/**
+ * GitHub rate limit buckets (each has its own quota)
+ */
+enum class RateResource {
+    CORE,    // REST endpoints: contents, trees, users...
+    SEARCH,  // /search/* endpoints
+    GRAPHQL  // /graphql (quota counted in query cost points)
+};
+
+/**
+ * Rate limit state reported by a single API response
+ * Fields are -1 (or 0 for reset) when the header was absent.
+ */
+struct RateLimitInfo {
+    int limit = -1;          // X-RateLimit-Limit
+    int remaining = -1;      // X-RateLimit-Remaining
+    long long reset = 0;     // X-RateLimit-Reset (unix seconds)
+    int retry_after = -1;    // Retry-After (seconds)
+};
+
+/**
+ * Token-bucket scheduler that paces requests per rate limit bucket
+ * The refill rate is recomputed from every response so the remaining quota
+ * is spread evenly until the window resets; Retry-After and exhausted
+ * buckets block callers until the server says it is safe to continue.
+ */
+class RateLimiter {
+public:
+    RateLimiter();
+
+    /**
+     * Block until a request against this bucket may be sent, then consume a token
+     */
+    void acquire(RateResource resource);
+
+    /**
+     * Feed the rate limit headers of a response back into the bucket
+     */
+    void update(RateResource resource, const RateLimitInfo& info);
+
+    /**
+     * Pause every request against this bucket for the given time
+     */
+    void backoff(RateResource resource, std::chrono::seconds delay);
+
+    /**
+     * Last known remaining quota for a bucket (-1 if unknown)
+     */
+    int remaining(RateResource resource) const;
+
+    /**
+     * How much quota this bucket can spend right now
+     * Remaining requests if open (the default limit if not yet known), or minus
+     * the seconds until it reopens if blocked - higher is always better.
+     */
+    double headroom(RateResource resource) const;
+
+    /**
+     * Map GitHub's X-RateLimit-Resource value ("core", "search", ...) to a bucket
+     */
+    static bool parseResource(const std::string& name, RateResource& resource);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Bucket {
+        double tokens;          // Requests that may be sent right now
+        double capacity;        // Maximum burst size
+        double refill_per_sec;  // Tokens added per second
+        int default_limit;      // Quota assumed before any headers arrive
+        int remaining = -1;     // Server-side quota left in this window
+        Clock::time_point last_refill;
+        Clock::time_point blocked_until;
+    };
+
+    Bucket& bucket(RateResource resource);
+    const Bucket& bucket(RateResource resource) const;
+    void refill(Bucket& b, Clock::time_point now);
+
+    mutable std::mutex mutex_;
+    Bucket core_;
+    Bucket search_;
+    Bucket graphql_;
+};
+
+} // namespace overwatch
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace overwatch {
+
+/**
+ * Persistent set of scanned repositories
+ * A memory-mapped, open-addressing hash table of 64-bit FNV-1a hashes of
+ * "owner/repo", with a blocked Bloom filter in front so most misses never
+ * touch the table. Opening an existing index is a single mmap regardless of
+ * its size; the table doubles (rewritten and renamed into place) once it is
+ * 70% full. Two names colliding on all 64 bits would make the second one
+ * look already scanned - an accepted trade for fixed-size slots.
+ * Thread-safe, and safe to share between processes (a daemon and a one-shot
+ * run): every lookup and insert holds flock() on <path>.lock - shared and
+ * exclusive respectively - and first remaps the index if another process
+ * has grown it and renamed a new file into place since.
+ * Meant to be opened once per process and shared for its lifetime.
+ */
+class RepoIndex {
+public:
+    /**
+     * Open the index, creating it if it does not exist
+     * @param path Index file (e.g. data/scanned_repos.idx)
+     * @param import_path Plain "owner/repo" list imported when the index is created
+     * Throws std::runtime_error if the file cannot be created or mapped.
+     */
+    explicit RepoIndex(const std::string& path, const std::string& import_path = "");
+    ~RepoIndex();
+
+    RepoIndex(const RepoIndex&) = delete;
+    RepoIndex& operator=(const RepoIndex&) = delete;
+
+    /**
+     * Check whether a repository was recorded (by any process)
+     */
+    bool contains(std::string_view owner, std::string_view repo);
+
+    /**
+     * Record a repository
+     * @return true if it was not recorded before
+     */
+    bool insert(std::string_view owner, std::string_view repo);
+
+    /**
+     * Number of repositories recorded
+     */
+    size_t size();
+
+    /**
+     * FNV-1a 64 of "owner/repo" (never 0, which marks empty slots)
+     */
+    static uint64_t hashKey(std::string_view owner, std::string_view repo);
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t bloom_hashes;
+        uint64_t capacity;       // Slots, power of two
+        uint64_t count;
+        uint64_t bloom_words;    // 64-bit words, multiple of kBloomBlockWords
+        uint64_t reserved[3];
+    };
+
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kMinCapacity = 1024;
+    static constexpr size_t kBloomBlockWords = 8;      // One 64-byte cache line per key
+    static constexpr uint32_t kBloomHashes = 6;
+
+    std::string path_;
+    int lock_fd_ = -1;           // <path>.lock; the index file itself is replaced when it grows
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    Header* header_ = nullptr;
+    uint64_t* bloom_ = nullptr;
+    uint64_t* slots_ = nullptr;
+    mutable std::mutex mutex_;
+
+    static size_t fileSize(uint64_t capacity);
+    static uint64_t bloomWords(uint64_t capacity);
+
+    bool open();
+    void create(const std::string& path, uint64_t capacity);
+    void mapFile();
+    void unmap();
+    void remapIfReplaced();
+    void grow();
+    void importList(const std::string& import_path);
+
+    bool containsHash(uint64_t hash) const;
+    bool insertHash(uint64_t hash);
+    void bloomAdd(uint64_t hash);
+    bool bloomTest(uint64_t hash) const;
+};
+
+} // namespace overwatch
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "tarball_reader.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * Represents a GitHub repository
+ */
+struct Repository {
+    std::string owner;
+    std::string name;
+    std::string url;
+    int stars;
+    std::string language;
+    bool archived;
+    std::string default_branch;
+    std::string pushed_at;    // ISO 8601, e.g. "2024-05-01T12:00:00Z" ("" if unknown)
+    std::string created_at;
+};
+
+/**
+ * Result ordering for repository search ("" keeps GitHub's best-match order)
+ */
+struct SearchOptions {
+    std::string sort;   // "stars", "forks", "help-wanted-issues" or "updated"
+    std::string order;  // "desc" or "asc"
+    int shard_workers = 4;  // Parallel searches when splitting a query past 1000 results (0 = never split)
+};
+
+/**
+ * One file of one repository, for batched fetches
+ */
+struct FileRequest {
+    std::string owner;
+    std::string repo;
+    std::string ref;    // Branch, tag or commit ("" = HEAD)
+    std::string path;
+};
+
+/**
+ * One page of repository search results
+ */
+struct SearchPage {
+    std::vector<Repository> repositories;
+    int page = 0;            // 1-based page number
+    long total_count = -1;   // Matches GitHub reports for the whole query (-1 if absent)
+};
+
+/**
+ * One entry of a Git tree listing
+ */
+struct TreeEntry {
+    std::string path;   // Full path within repository
+    std::string sha;    // Git object SHA
+    std::string type;   // "blob", "tree" or "commit"
+    long size;          // Blob size in bytes (0 for trees)
+};
+
+/**
+ * Result of a Git Trees API call
+ */
+struct RepositoryTree {
+    std::vector<TreeEntry> entries;
+    bool truncated = false;  // GitHub cut the listing short (very large repos)
+};
+
+/**
+ * A downloaded file
+ */
+struct FileContent {
+    std::string content;  // Decoded file text
+    std::string sha;      // Git blob SHA reported by the Contents API
+};
+
+/**
+ * Where a scan gets repositories and their files from
+ * GitHubClient serves the live API (or HTTP fixtures recorded from it);
+ * LocalDirectorySource serves directories on disk. Implementations must be
+ * safe to call from several scan workers at once.
+ */
+class RepoSource {
+public:
+    virtual ~RepoSource() = default;
+
+    /**
+     * Stream the repositories matching a query page by page
+     * @param query Search query (sources without search may ignore it)
+     * @param max_results Maximum number of repositories (0 = all)
+     * @param options Sort order of the results
+     * @param on_page Called with each page, never concurrently; return false to stop
+     * @return Number of repositories delivered
+     */
+    virtual int searchRepositoriesPaged(const std::string& query, int max_results, const SearchOptions& options,
+                                        const std::function<bool(SearchPage&)>& on_page) = 0;
+
+    /**
+     * List a repository's files
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param ref Branch, tag or tree SHA (e.g. "HEAD")
+     * @param recursive Include entries from all subdirectories
+     * @return Tree entries (empty for an empty repository)
+     */
+    virtual RepositoryTree getTree(const std::string& owner, const std::string& repo,
+                                   const std::string& ref, bool recursive = true) = 0;
+
+    /**
+     * Fetch several files from one repository
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param paths File paths within repository
+     * @param max_in_flight Maximum number of reads or requests running at once
+     * @return Contents in the same order as paths (nullopt if missing)
+     */
+    virtual std::vector<std::optional<FileContent>> getFileContents(const std::string& owner, const std::string& repo,
+                                                                    const std::vector<std::string>& paths,
+                                                                    int max_in_flight) = 0;
+
+    /**
+     * Fetch files of many repositories at once
+     * @param requests Files to fetch, from any number of repositories
+     * @param max_in_flight Maximum number of per-file reads or requests running at once
+     * @return Contents in request order (nullopt where the file doesn't exist or failed)
+     */
+    virtual std::vector<std::optional<FileContent>> batchGetFiles(const std::vector<FileRequest>& requests,
+                                                                  int max_in_flight) = 0;
+
+    /**
+     * Feed a whole repository archive through a reader
+     * @param owner Repository owner
+     * @param repo Repository name
+     * @param ref Branch, tag or commit SHA (e.g. "HEAD")
+     * @param reader Receives the archive bytes
+     * @return true if the whole archive was read (false if there is none to read)
+     */
+    virtual bool streamTarball(const std::string& owner, const std::string& repo,
+                               const std::string& ref, TarballReader& reader) = 0;
+};
+
+} // namespace overwatch
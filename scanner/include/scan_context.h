@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace overwatch {
+
+/**
+ * Scratch memory of one scan worker
+ * Detector scratch - literal hit lists, candidate patterns, match spans - is
+ * carved out of a monotonic arena instead of the heap: allocating is a
+ * pointer bump and freeing does nothing until reset(), which drops it all at
+ * once. The worker resets between repositories. When a repository needed
+ * more than the first block, reset() grows that block to the high-water mark
+ * (up to kMaxRetainedBytes), so a warmed-up worker stops touching the heap.
+ * Only scratch belongs here: file contents, parsed API strings and
+ * Match::matched_text outlive the reset and are heap-allocated.
+ * Not thread-safe: one context per worker thread.
+ */
+class ScanContext {
+public:
+    explicit ScanContext(size_t initial_bytes = kInitialBytes);
+
+    ScanContext(const ScanContext&) = delete;
+    ScanContext& operator=(const ScanContext&) = delete;
+
+    /**
+     * The arena, for std::pmr containers
+     */
+    std::pmr::memory_resource* memory() { return &*arena_; }
+
+    /**
+     * Release everything allocated since the last reset
+     */
+    void reset();
+
+    /**
+     * Size of the block kept across resets
+     */
+    size_t retainedBytes() const { return block_bytes_; }
+
+    static constexpr size_t kInitialBytes = 256 * 1024;
+    static constexpr size_t kMaxRetainedBytes = 16 * 1024 * 1024;
+
+private:
+    // Heap blocks the arena took beyond the first one, counted to size the next first block
+    class Overflow : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* p, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::unique_ptr<std::byte[]> block_;
+    size_t block_bytes_;
+    Overflow overflow_;
+    std::optional<std::pmr::monotonic_buffer_resource> arena_;
+};
+
+} // namespace overwatch
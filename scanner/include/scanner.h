@@ -1,36 +1,124 @@
 #pragma once
 
-#include "github_client.h"
+#include "blob_cache.h"
+#include "findings_writer.h"
+#include "repo_index.h"
+#include "repo_source.h"
+#include "scan_context.h"
 #include "secret_detector.h"
+#include <atomic>
 #include <string>
 #include <vector>
 #include <unordered_set>
 
 namespace overwatch {
 
+/**
+ * How candidate files are downloaded
+ */
+enum class FetchMode {
+    AUTO,       // Tarball when a repository has many candidates and is small enough, else contents
+    CONTENTS,   // One contents API request per file
+    TARBALL,    // One archive download per repository, streamed through the detector
+    GRAPHQL     // Files of several repositories at once through aliased GraphQL queries
+};
+
+/**
+ * Tunables for a scan run
+ */
+struct ScanConfig {
+    int fetch_concurrency = 8;  // File requests in flight per repository
+    bool use_tree = true;       // List the repo tree first and only fetch files that exist
+    int max_tree_files = 64;    // Cap on tree candidates fetched per repository
+    int scan_workers = 4;       // Repositories scanned in parallel
+    int queue_capacity = 64;    // Repositories buffered between search and scan stages
+    FetchMode fetch_mode = FetchMode::AUTO;
+    int tarball_min_files = 16;                   // AUTO: files left to fetch that make an archive worth it
+    long tarball_max_bytes = 32L * 1024 * 1024;   // AUTO: largest repository (sum of blob sizes) to download whole
+    int graphql_batch_repos = 8;                  // GRAPHQL: repositories a worker fetches files for together
+    bool keep_low_entropy = false;   // Report matches under their pattern's min_entropy (flagged) instead of dropping them
+    // Drain when set: searches stop, queued repositories are left for a later run
+    // (not marked scanned), repositories being scanned finish and are written out
+    const std::atomic<bool>* stop = nullptr;
+};
+
+/**
+ * What one Scanner::run() saw
+ */
+struct ScanStats {
+    int found = 0;                  // Repositories returned by the search
+    int scanned = 0;
+    int skipped = 0;                // Archived or already scanned
+    int duplicates = 0;             // Already queued by another search of the same batch
+    int findings = 0;               // In the repositories this run scanned
+    // Latest pushed_at the next incremental run may start from: every result
+    // pushed before it was scanned or skipped
+    std::string newest_pushed_at;
+};
+
+/**
+ * One search of a Scanner::runBatch()
+ */
+struct ScanJob {
+    std::string query;
+    int max_repos = 0;      // 0 = unlimited
+    SearchOptions options;
+};
+
 class Scanner {
 public:
     /**
      * Create a scanner
-     * @param client GitHub API client
+     * @param source Where repositories and files come from (GitHubClient, LocalDirectorySource)
      * @param detector Secret detector with loaded patterns
-     * @param output_file Path to output JSONL file
+     * @param scanned Index of already scanned repositories (shared across scans)
+     * @param sink Where findings are written (shared across scans; flushed at the end of each)
+     * @param config Scan tunables
+     * @param blob_cache Results of previously scanned blobs (nullptr to always fetch and scan)
      */
-    Scanner(GitHubClient& client, SecretDetector& detector, const std::string& output_file);
+    Scanner(RepoSource& source, SecretDetector& detector, RepoIndex& scanned,
+            FindingsSink& sink, const ScanConfig& config = ScanConfig(),
+            BlobCache* blob_cache = nullptr);
 
     /**
      * Run the scanner
-     * @param search_query GitHub search query
+     * Search results feed a bounded queue drained by config.scan_workers threads;
+     * a single writer thread hands their findings to the sink.
+     * @param search_query Search query (passed to the source)
      * @param max_repos Maximum number of repositories to scan
+     * @param search_options Sort order of the search results
+     * @return Counts and the newest push time seen (for incremental queries)
+     */
+    ScanStats run(const std::string& search_query, int max_repos,
+                  const SearchOptions& search_options = SearchOptions());
+
+    /**
+     * Run several searches through one worker pool and findings writer thread
+     * Up to parallel_searches searches feed the repository queue at once. A
+     * repository returned by more than one of them is queued only for the
+     * first, so it is fetched and scanned once.
+     * @param jobs Searches to run
+     * @param parallel_searches Searches in flight at once
+     * @return Stats per job, in job order; scanned counts the repositories the job queued
+     */
+    std::vector<ScanStats> runBatch(const std::vector<ScanJob>& jobs, int parallel_searches);
+
+    /**
+     * Parse a fetch mode name: "auto", "contents", "tarball", "graphql"
+     * Throws std::runtime_error on anything else.
      */
-    void run(const std::string& search_query, int max_repos);
+    static FetchMode parseFetchMode(const std::string& name);
+
+    // Contents API refuses to return blobs larger than 1 MB
+    static constexpr long kMaxBlobSize = 1024 * 1024;
 
 private:
-    GitHubClient& client_;
+    RepoSource& source_;
     SecretDetector& detector_;
-    std::string output_file_;
-    std::string scanned_repos_file_;
-    std::unordered_set<std::string> scanned_repos_;
+    RepoIndex& scanned_;
+    FindingsSink& sink_;
+    ScanConfig config_;
+    BlobCache* blob_cache_;
 
     // List of suspicious filenames to check
     std::vector<std::string> suspicious_files_ = {
@@ -60,12 +148,33 @@ private:
         "bot.config"
     };
 
-    void scanRepository(const Repository& repo);
-    void writeFinding(const std::string& owner, const std::string& repo,
-                     const std::string& file, const Match& match);
-    void loadScannedRepos();
-    void saveScannedRepo(const std::string& owner, const std::string& repo);
-    bool isAlreadyScanned(const std::string& owner, const std::string& repo);
+    // Directories skipped when selecting candidates from a tree listing
+    std::unordered_set<std::string> excluded_dirs_ = {
+        "node_modules",
+        "vendor",
+        ".git",
+        "venv",
+        ".venv",
+        "site-packages",
+        "bower_components"
+    };
+
+    std::vector<Finding> scanRepository(const Repository& repo, ScanContext& context);
+    std::vector<Finding> scanBatch(const std::vector<Repository>& repos, ScanContext& context);
+    std::vector<TreeEntry> candidateFiles(const Repository& repo, bool& tarball_allowed);
+    void scanFiles(const Repository& repo, const std::string& ref, const std::vector<TreeEntry>& files,
+                   bool tarball_allowed, ScanContext& context, std::vector<Finding>& findings);
+
+    // Report a blob scanned before; false if its result isn't cached
+    bool reportCached(const Repository& repo, const TreeEntry& file, std::vector<Finding>& findings);
+    void scanFetched(const Repository& repo, const std::string& path, const FileContent& file,
+                     bool checked, ScanContext& context, std::vector<Finding>& findings);
+    void scanBlob(const Repository& repo, const std::string& path, const std::string& sha,
+                  const std::string& content, ScanContext& context, std::vector<Finding>& findings);
+    void report(const Repository& repo, const std::string& path, std::vector<Match> matches,
+                std::vector<Finding>& findings);
+    std::vector<TreeEntry> selectTreeCandidates(const RepositoryTree& tree);
+    std::vector<TreeEntry> probeEntries(const std::vector<TreeEntry>& known = {}) const;
 };
 
 } // namespace overwatch
@@ -1,45 +1,187 @@
 #pragma once
 
+#include "entropy.h"
+#include "file_dispatch.h"
+#include "literal_prefilter.h"
+#include "matcher_engine.h"
+#include "scan_context.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <regex>
 
 namespace overwatch {
 
+class Counter;
+class Histogram;
+
 struct Pattern {
     std::string name;
-    std::regex regex;
+    std::string regex;               // Source; compiled by the matcher engine
     std::vector<std::string> files;
+    std::string prefilter;           // Literal every match contains ("" = always run the regex)
+    int literal_id = -1;             // Id of prefilter in the LiteralPrefilter
+    float min_entropy = 0;           // Matches whose secret scores lower are flagged low_entropy (0 = none)
 };
 
 struct Match {
-    std::string pattern_name;
+    size_t pattern_index;   // Index into SecretDetector::patterns()
     int line_number;
     std::string matched_text;
+    float entropy = 0;          // Of the secret value in matched_text, bits per character
+    bool low_entropy = false;   // Below the pattern's min_entropy, probably a placeholder
+};
+
+/**
+ * Cumulative cost of one pattern, see SecretDetector::patternCosts()
+ */
+struct PatternCost {
+    std::string name;
+    uint64_t files = 0;         // Files the pattern was run over (its literal, if any, occurred)
+    uint64_t matches = 0;
+    uint64_t total_nanos = 0;
+    uint64_t p99_nanos = 0;     // Per file
+    uint64_t max_nanos = 0;
+    uint64_t over_budget = 0;   // Files cut short by the pattern budget
+    uint64_t low_entropy = 0;   // Matches under the pattern's min_entropy
+};
+
+/**
+ * A match located in a scanned buffer, without owning any text
+ * offset/length index into the buffer passed to scanBuffer().
+ */
+struct MatchSpan {
+    size_t pattern_index;   // Index into patterns()
+    size_t offset;
+    size_t length;
+    float entropy = 0;          // See Match
+    bool low_entropy = false;
 };
 
 class SecretDetector {
 public:
-    SecretDetector();
+    /**
+     * Create a detector
+     * @param engine Matcher engine name ("auto", "re2", "std")
+     */
+    explicit SecretDetector(const std::string& engine = "auto");
 
     /**
-     * Load patterns from YAML file
+     * Load patterns from YAML file and compile them into the matcher engine
      * @param yaml_path Path to patterns.yaml
      */
     void loadPatterns(const std::string& yaml_path);
 
+    /**
+     * Limit the time one pattern may spend on one file
+     * A pattern that runs over stops for the rest of that file; the skip is
+     * logged and counted. The clock is read between searches, so no single
+     * search may be unbounded: on lines longer than kMaxRegexLineLength a
+     * backtracking engine (std::regex) is swapped for RE2 when it is built in.
+     * Without RE2, anchored patterns search kAnchorWindow bytes either side
+     * of each literal hit instead of the whole line, and other patterns skip
+     * the line, which counts as going over budget.
+     * @param budget Zero (the default) disables the limit
+     */
+    void setPatternBudget(std::chrono::nanoseconds budget) { pattern_budget_ = budget; }
+
+    // Longest line a backtracking engine searches whole while a budget is set
+    static constexpr size_t kMaxRegexLineLength = 4096;
+
+    // Bytes searched either side of a literal hit on a longer line; no secret is longer
+    static constexpr size_t kAnchorWindow = 1024;
+
+    /**
+     * Time, matches and budget skips of every pattern so far, in pattern order
+     * Only the per-line locate phase is attributed; the shared literal
+     * prefilter and single-pass engine stages are not split by pattern.
+     */
+    std::vector<PatternCost> patternCosts() const;
+
+    /**
+     * Name of the matcher engine in use
+     */
+    std::string engineName() const { return engine_->name(); }
+
     /**
      * Scan content for secrets
+     * Wraps scanBuffer() and materializes each span as an owned Match.
      * @param content File content to scan
      * @param filename Name of file being scanned (for file-specific patterns)
+     * @param context Arena for the scan's scratch memory (nullptr to use the heap)
      * @return Vector of matches found
      */
-    std::vector<Match> scanContent(const std::string& content, const std::string& filename);
+    std::vector<Match> scanContent(std::string_view content, std::string_view filename,
+                                   ScanContext* context = nullptr) const;
+
+    /**
+     * Scan a contiguous buffer for secrets without copying it
+     * Spans come back line by line, in pattern order within a line (the
+     * order scanContent() reports them in). Each is scored by the entropy of
+     * its secret value (see entropy.h) and flagged low_entropy if that is
+     * under its pattern's min_entropy; dropping those is up to the caller.
+     * @param content File content to scan; spans point into it
+     * @param filename Name of file being scanned (for file-specific patterns)
+     * @param memory Where the spans and every scratch list of the scan are allocated
+     * @return Match spans
+     */
+    std::pmr::vector<MatchSpan> scanBuffer(std::string_view content, std::string_view filename,
+                                           std::pmr::memory_resource* memory = std::pmr::new_delete_resource()) const;
+
+    /**
+     * 1-based line number of a byte offset in content
+     */
+    static int lineNumberAt(std::string_view content, size_t offset);
+
+    /**
+     * Hash of every loaded pattern's definition
+     * Changes whenever a pattern is added, removed or edited, so results
+     * cached under it are never reused against a different pattern set.
+     */
+    uint64_t patternSetHash() const { return pattern_set_hash_; }
+
+    /**
+     * Identify which patterns apply to a filename
+     * Files with equal profiles are scanned with exactly the same patterns.
+     */
+    uint64_t patternProfile(std::string_view filename) const { return dispatch_.lookup(filename).signature; }
+
+    /**
+     * Loaded patterns, indexed by MatchSpan::pattern_index
+     */
+    const std::vector<Pattern>& patterns() const { return patterns_; }
+
+    /**
+     * Check whether any pattern names this file in its files: list
+     * The catch-all "*" is ignored, so only explicit names and *.ext globs count
+     * @param filename Base name of the file (no directories)
+     * @return true if at least one pattern targets this file
+     */
+    bool isTargetedFile(const std::string& filename) const;
 
 private:
     std::vector<Pattern> patterns_;
+    std::unique_ptr<MatcherEngine> engine_;
+    std::unique_ptr<MatcherEngine> long_line_engine_;  // RE2 for long lines when engine_ backtracks
+    LiteralPrefilter prefilter_;
+    FileDispatch dispatch_;
+    std::chrono::nanoseconds pattern_budget_{0};
+    uint64_t pattern_set_hash_ = 0;
+
+    // Per-pattern series, owned by the metrics registry
+    struct PatternMetrics {
+        Histogram* time;
+        Counter* matches;
+        Counter* over_budget;
+        Counter* low_entropy;
+    };
+    std::vector<PatternMetrics> pattern_metrics_;
 
-    bool fileMatchesPattern(const std::string& filename, const std::vector<std::string>& file_patterns);
+    // Bytes searched between two reads of the clock while a budget is set
+    static constexpr size_t kBudgetCheckBytes = 4096;
 };
 
 } // namespace overwatch
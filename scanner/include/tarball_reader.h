@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct z_stream_s;
+
+namespace overwatch {
+
+/**
+ * Streaming reader for gzipped tar archives (GitHub repository tarballs)
+ * Compressed bytes go in through feed() as they arrive from the network; the
+ * stream is inflated and untarred on the fly and only the entries the filter
+ * asks for are buffered, one at a time, so nothing touches the disk and memory
+ * stays bounded by the largest wanted file. GitHub wraps every path in a
+ * "<owner>-<repo>-<sha>/" directory, which is stripped from entry paths.
+ * Understands ustar headers, pax extended headers and GNU long names.
+ */
+class TarballReader {
+public:
+    /**
+     * Decide whether to keep a regular file (path relative to the repository root)
+     */
+    using EntryFilter = std::function<bool(const std::string& path, size_t size)>;
+
+    /**
+     * Receive a kept file; return false to stop reading the archive
+     */
+    using EntryHandler = std::function<bool(const std::string& path, std::string&& content)>;
+
+    /**
+     * @param filter Called for every regular file
+     * @param handler Called with the contents of each file the filter kept
+     * @param max_entry_size Files larger than this are skipped without asking the filter
+     */
+    TarballReader(EntryFilter filter, EntryHandler handler, size_t max_entry_size);
+    ~TarballReader();
+
+    TarballReader(const TarballReader&) = delete;
+    TarballReader& operator=(const TarballReader&) = delete;
+
+    /**
+     * Consume the next chunk of the gzipped archive
+     * @return false once reading stopped (handler declined, or the stream is corrupt)
+     */
+    bool feed(const char* data, size_t size);
+
+    /**
+     * @return true if the archive was read to its end without errors
+     */
+    bool finish() const;
+
+    /**
+     * Why reading stopped ("" if it didn't or the handler asked to)
+     */
+    const std::string& error() const { return error_; }
+
+    /**
+     * Regular files seen so far, kept or not
+     */
+    size_t entries() const { return entries_; }
+
+private:
+    enum class State {
+        HEADER,      // Collecting a 512-byte header block
+        DATA,        // Inside an entry's data (kept, skipped or metadata)
+        PADDING,     // Zero fill up to the next block boundary
+        END          // Two zero blocks (or end of the gzip stream) seen
+    };
+
+    enum class Body {
+        SKIP,        // Discard
+        FILE,        // Buffer and hand to the handler
+        PAX,         // pax extended header records
+        LONG_NAME    // GNU long name of the next entry
+    };
+
+    EntryFilter filter_;
+    EntryHandler handler_;
+    size_t max_entry_size_;
+
+    std::unique_ptr<z_stream_s> stream_;
+    bool inflate_done_ = false;
+
+    State state_ = State::HEADER;
+    Body body_ = Body::SKIP;
+    std::string header_;             // Partial header block
+    std::string path_;               // Path of the entry being read
+    std::string next_path_;          // Path override from a pax or GNU long name header
+    std::string content_;            // Buffered data of the entry being read
+    size_t remaining_ = 0;           // Data bytes left in the current entry
+    size_t padding_ = 0;             // Padding bytes left before the next header
+    int zero_blocks_ = 0;
+    size_t entries_ = 0;
+    bool stopped_ = false;
+    std::string error_;
+
+    bool consume(const char* data, size_t size);
+    bool parseHeader();
+    bool endEntry();
+    void parsePax(const std::string& records);
+    bool fail(const std::string& message);
+};
+
+} // namespace overwatch
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rate_limiter.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace overwatch {
+
+/**
+ * One GitHub token and its live quota state
+ */
+struct TokenState {
+    std::string token;     // Empty for unauthenticated access
+    std::string label;     // Masked form safe for logs (e.g. "ghp_ab...")
+    RateLimiter limiter;   // Quota tracked from this token's responses
+};
+
+/**
+ * Set of GitHub tokens that share the request load
+ * Each token keeps its own rate limit buckets; requests go to the token
+ * with the most headroom in the bucket they need.
+ */
+class TokenPool {
+public:
+    /**
+     * Create a pool
+     * @param tokens GitHub tokens (empty list for unauthenticated access)
+     */
+    explicit TokenPool(const std::vector<std::string>& tokens);
+
+    /**
+     * Read tokens from the environment
+     * GITHUB_TOKENS (comma/space separated), GITHUB_TOKENS_FILE (one per line,
+     * '#' comments) and GITHUB_TOKEN are combined, duplicates removed.
+     */
+    static std::vector<std::string> loadFromEnvironment();
+
+    /**
+     * Pick the token with the most headroom for a bucket
+     */
+    TokenState& select(RateResource resource);
+
+    /**
+     * Drop a token (e.g. after failed validation)
+     * Not safe while requests are in flight - call during startup only
+     */
+    void remove(size_t index);
+
+    size_t size() const { return tokens_.size(); }
+    bool authenticated() const { return !tokens_.empty() && !tokens_[0]->token.empty(); }
+    TokenState& at(size_t index) { return *tokens_[index]; }
+
+private:
+    std::vector<std::unique_ptr<TokenState>> tokens_;
+    std::mutex mutex_;
+    size_t next_ = 0;  // Round-robin start so ties spread across tokens
+};
+
+} // namespace overwatch
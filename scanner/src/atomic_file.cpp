@@ -0,0 +1,56 @@
+#include "atomic_file.h"
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace overwatch {
+
+namespace fs = std::filesystem;
+
+std::string hashedPath(const std::string& dir, const std::string& key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return dir + "/" + std::string(name, 2) + "/" + name;
+}
+
+bool writeFileAtomically(const std::string& path, const std::function<void(std::ostream&)>& write) {
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    std::ostringstream tmp_name;
+    tmp_name << path << ".tmp." << ::getpid() << "." << std::this_thread::get_id();
+    std::string tmp_path = tmp_name.str();
+
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        write(out);
+        out.flush();
+        if (!out) {
+            out.close();
+            fs::remove(tmp_path, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tmp_path, path, ec);
+    if (ec) {
+        fs::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace overwatch
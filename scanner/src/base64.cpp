@@ -29,13 +29,27 @@
 
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
 
+   Altered for OverWatch: base64_decode() uses a table-driven decoder with
+   SSE4.1/AVX2 (selected at runtime) or NEON block decoding, and skips line
+   breaks in the same pass instead of copying the input first.
+
 */
 
 #include "base64.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_X86_DISPATCH
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define BASE64_NEON
+#include <arm_neon.h>
+#endif
+
  //
  // Depending on the url parameter in base64_chars, one of
  // two sets of base64 characters needs to be chosen.
@@ -52,24 +66,6 @@ static const char* base64_chars[2] = {
              "0123456789"
              "-_"};
 
-static unsigned int pos_of_char(const unsigned char chr) {
- //
- // Return the position of chr within base64_encode()
- //
-
-    if      (chr >= 'A' && chr <= 'Z') return chr - 'A';
-    else if (chr >= 'a' && chr <= 'z') return chr - 'a' + ('Z' - 'A')               + 1;
-    else if (chr >= '0' && chr <= '9') return chr - '0' + ('Z' - 'A') + ('z' - 'a') + 2;
-    else if (chr == '+' || chr == '-') return 62; // Be liberal with input and accept both url ('-') and non-url ('+') base 64 characters (
-    else if (chr == '/' || chr == '_') return 63; // Ditto for '/' and '_'
-    else
- //
- // 2020-10-23: Throw std::exception rather than const char*
- //(Pablo Martin-Gomez, https://github.com/Bouska)
- //
-    throw std::runtime_error("Input is not valid base64-encoded data.");
-}
-
 static std::string insert_linebreaks(std::string str, size_t distance) {
  //
  // Provided by https://github.com/JomaCorpFX, adapted by me.
@@ -159,6 +155,227 @@ std::string base64_encode(unsigned char const* bytes_to_encode, size_t in_len, b
     return ret;
 }
 
+//
+// Decoding tables: the 6-bit value of every base64 character (both the
+// standard and the url alphabet), kInvalid for everything else.
+//
+static const uint8_t kInvalid = 0xff;
+
+struct decode_table {
+    uint8_t value[256];
+
+    decode_table() : value() {
+        std::memset(value, kInvalid, sizeof(value));
+        for (unsigned int i = 0; i < 64; i++) {
+            value[static_cast<unsigned char>(base64_chars[0][i])] = static_cast<uint8_t>(i);
+            value[static_cast<unsigned char>(base64_chars[1][i])] = static_cast<uint8_t>(i);
+        }
+    }
+};
+
+static const decode_table kDecodeTable;
+
+//
+// Block decoders turn runs of clean base64 (no padding, line breaks or
+// invalid characters) into bytes, a whole vector at a time. Each returns the
+// number of input characters consumed - a multiple of 4 - and stops at the
+// first block it can't handle, leaving it to the scalar loop. Output stores
+// may write up to 8 bytes past the decoded data.
+//
+using block_decoder = size_t (*)(const unsigned char* in, size_t length, unsigned char* out);
+
+#if defined(BASE64_X86_DISPATCH)
+
+//
+// Lanes of x within [lo, hi]. Bytes >= 0x80 compare as negative and fall
+// outside every range.
+//
+__attribute__((target("sse4.1")))
+static inline __m128i in_range(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i in_range(__m256i x, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), x));
+}
+
+//
+// Map 16 characters to their 6-bit values; false if any isn't in either alphabet
+//
+__attribute__((target("sse4.1")))
+static inline bool translate_sse(__m128i c, __m128i& values) {
+    __m128i upper = in_range(c, 'A', 'Z');
+    __m128i lower = in_range(c, 'a', 'z');
+    __m128i digit = in_range(c, '0', '9');
+    __m128i v62 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('+')), _mm_cmpeq_epi8(c, _mm_set1_epi8('-')));
+    __m128i v63 = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')), _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, v62), v63));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+        return false;
+    }
+
+    values = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A'))),
+                     _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26)))),
+        _mm_or_si128(_mm_and_si128(digit, _mm_add_epi8(c, _mm_set1_epi8(52 - '0'))),
+                     _mm_or_si128(_mm_and_si128(v62, _mm_set1_epi8(62)), _mm_and_si128(v63, _mm_set1_epi8(63)))));
+    return true;
+}
+
+//
+// Pack 16 6-bit values into 12 bytes (in the low 12 bytes of the result)
+//
+__attribute__((target("sse4.1")))
+static inline __m128i pack_sse(__m128i values) {
+    // [00aaaaaa 00bbbbbb] -> 0000aaaa aabbbbbb, then pairs of those -> 24 bits per dword
+    __m128i ab = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i abcd = _mm_madd_epi16(ab, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(abcd, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("sse4.1")))
+static size_t decode_blocks_sse41(const unsigned char* in, size_t length, unsigned char* out) {
+    size_t consumed = 0;
+
+    while (length - consumed >= 16) {
+        __m128i values;
+        if (!translate_sse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + consumed)), values)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), pack_sse(values));
+        out += 12;
+        consumed += 16;
+    }
+
+    return consumed;
+}
+
+__attribute__((target("avx2")))
+static size_t decode_blocks_avx2(const unsigned char* in, size_t length, unsigned char* out) {
+    size_t consumed = 0;
+
+    while (length - consumed >= 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + consumed));
+
+        __m256i upper = in_range(c, 'A', 'Z');
+        __m256i lower = in_range(c, 'a', 'z');
+        __m256i digit = in_range(c, '0', '9');
+        __m256i v62 = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('+')),
+                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-')));
+        __m256i v63 = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('/')),
+                                      _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                        _mm256_or_si256(_mm256_or_si256(digit, v62), v63));
+        if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffffu) {
+            break;
+        }
+
+        __m256i values = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(upper, _mm256_sub_epi8(c, _mm256_set1_epi8('A'))),
+                            _mm256_and_si256(lower, _mm256_sub_epi8(c, _mm256_set1_epi8('a' - 26)))),
+            _mm256_or_si256(_mm256_and_si256(digit, _mm256_add_epi8(c, _mm256_set1_epi8(52 - '0'))),
+                            _mm256_or_si256(_mm256_and_si256(v62, _mm256_set1_epi8(62)),
+                                            _mm256_and_si256(v63, _mm256_set1_epi8(63)))));
+
+        // Same packing as SSE per 128-bit lane, then close the gap between the lanes
+        __m256i ab = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i abcd = _mm256_madd_epi16(ab, _mm256_set1_epi32(0x00011000));
+        __m256i packed = _mm256_shuffle_epi8(abcd, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+        out += 24;
+        consumed += 32;
+    }
+
+    // A 16-character tail still fits the SSE path (GitHub's 60-character lines leave 28)
+    return consumed + decode_blocks_sse41(in + consumed, length - consumed, out);
+}
+
+static block_decoder select_block_decoder() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return decode_blocks_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return decode_blocks_sse41;
+    }
+    return nullptr;
+}
+
+#elif defined(BASE64_NEON)
+
+//
+// Map 8 characters to their 6-bit values; false if any isn't in either alphabet
+//
+static inline bool translate_neon(uint8x8_t c, uint8x8_t& values) {
+    auto in_range = [](uint8x8_t x, uint8_t lo, uint8_t hi) {
+        return vand_u8(vcge_u8(x, vdup_n_u8(lo)), vcle_u8(x, vdup_n_u8(hi)));
+    };
+
+    uint8x8_t upper = in_range(c, 'A', 'Z');
+    uint8x8_t lower = in_range(c, 'a', 'z');
+    uint8x8_t digit = in_range(c, '0', '9');
+    uint8x8_t v62 = vorr_u8(vceq_u8(c, vdup_n_u8('+')), vceq_u8(c, vdup_n_u8('-')));
+    uint8x8_t v63 = vorr_u8(vceq_u8(c, vdup_n_u8('/')), vceq_u8(c, vdup_n_u8('_')));
+
+    uint8x8_t valid = vorr_u8(vorr_u8(upper, lower), vorr_u8(vorr_u8(digit, v62), v63));
+    if (vget_lane_u64(vreinterpret_u64_u8(valid), 0) != ~0ULL) {
+        return false;
+    }
+
+    values = vorr_u8(
+        vorr_u8(vand_u8(upper, vsub_u8(c, vdup_n_u8('A'))),
+                vand_u8(lower, vsub_u8(c, vdup_n_u8('a' - 26)))),
+        vorr_u8(vand_u8(digit, vadd_u8(c, vdup_n_u8(static_cast<uint8_t>(52 - '0')))),
+                vorr_u8(vand_u8(v62, vdup_n_u8(62)), vand_u8(v63, vdup_n_u8(63)))));
+    return true;
+}
+
+static size_t decode_blocks_neon(const unsigned char* in, size_t length, unsigned char* out) {
+    size_t consumed = 0;
+
+    while (length - consumed >= 32) {
+        // De-interleave into the 1st, 2nd, 3rd and 4th character of 8 groups
+        uint8x8x4_t c = vld4_u8(in + consumed);
+        uint8x8_t a, b, d, e;
+        if (!translate_neon(c.val[0], a) || !translate_neon(c.val[1], b) ||
+            !translate_neon(c.val[2], d) || !translate_neon(c.val[3], e)) {
+            break;
+        }
+
+        uint8x8x3_t bytes;
+        bytes.val[0] = vorr_u8(vshl_n_u8(a, 2), vshr_n_u8(b, 4));
+        bytes.val[1] = vorr_u8(vshl_n_u8(b, 4), vshr_n_u8(d, 2));
+        bytes.val[2] = vorr_u8(vshl_n_u8(d, 6), e);
+        vst3_u8(out, bytes);
+
+        out += 24;
+        consumed += 32;
+    }
+
+    return consumed;
+}
+
+static block_decoder select_block_decoder() {
+    return decode_blocks_neon;
+}
+
+#else
+
+static block_decoder select_block_decoder() {
+    return nullptr;
+}
+
+#endif
+
 template <typename String>
 static std::string decode(String const& encoded_string, bool remove_linebreaks) {
  //
@@ -168,75 +385,96 @@ static std::string decode(String const& encoded_string, bool remove_linebreaks)
 
     if (encoded_string.empty()) return std::string();
 
-    if (remove_linebreaks) {
-
-       std::string copy(encoded_string);
+    static const block_decoder decode_blocks = select_block_decoder();
 
-       copy.erase(std::remove(copy.begin(), copy.end(), '\n'), copy.end());
-
-       return base64_decode(copy, false);
-    }
-
-    size_t length_of_string = encoded_string.length();
-    size_t pos = 0;
+    const auto* in = reinterpret_cast<const unsigned char*>(encoded_string.data());
+    size_t length = encoded_string.length();
 
  //
- // The approximate length (bytes) of the decoded string might be one or
- // two bytes smaller, depending on the amount of trailing equal signs
- // in the encoded string. This approximation is needed to reserve
- // enough space in the string to be returned.
+ // Every 4 characters produce at most 3 bytes; the slack absorbs the
+ // block decoders' full-vector stores.
  //
-    size_t approx_length_of_decoded_string = length_of_string / 4 * 3;
-    std::string ret;
-    ret.reserve(approx_length_of_decoded_string);
+    std::string ret(length / 4 * 3 + 3 + 32, '\0');
+    auto* out = reinterpret_cast<unsigned char*>(&ret[0]);
+    size_t written = 0;
 
-    while (pos < length_of_string) {
-    //
-    // Iterate over encoded input string in chunks. The size of all
-    // chunks except the last one is 4 bytes.
-    //
-    // The last chunk might be padded with equal signs or dots
-    // in order to make it 4 bytes in size as well, but this
-    // is not required as per RFC 2045.
-    //
-    // All chunks except the last one produce three output bytes.
+    uint8_t quad[4];
+    size_t in_quad = 0;
+    size_t pos = 0;
+    size_t skip = 0;  // Positions left in a group that ended with padding
+    bool try_blocks = decode_blocks != nullptr;
+
+    while (pos < length) {
     //
-    // The last chunk produces at least one and up to three bytes.
+    // Between groups, hand the longest clean run to the vector decoder. Where
+    // it stops, the scalar loop takes over until it has passed the line break
+    // (or padding) that stopped it.
     //
+       if (in_quad == 0 && skip == 0 && try_blocks) {
+          size_t consumed = decode_blocks(in + pos, length - pos, out + written);
+          pos += consumed;
+          written += consumed / 4 * 3;
+          try_blocks = false;
+          if (pos >= length) break;
+       }
+
+       unsigned char chr = in[pos++];
+       uint8_t value = kDecodeTable.value[chr];
 
-       size_t pos_of_char_1 = pos_of_char(encoded_string.at(pos+1) );
+       if (chr == '\n' && remove_linebreaks) {
+          try_blocks = decode_blocks != nullptr;
+          continue;
+       }
+
+       if (skip > 0) {
+          skip--;
+          continue;
+       }
+
+       if (value != kInvalid) {
+          quad[in_quad++] = value;
+          if (in_quad == 4) {
+             out[written++] = static_cast<unsigned char>((quad[0] << 2) | (quad[1] >> 4));
+             out[written++] = static_cast<unsigned char>((quad[1] << 4) | (quad[2] >> 2));
+             out[written++] = static_cast<unsigned char>((quad[2] << 6) | quad[3]);
+             in_quad = 0;
+          }
+          continue;
+       }
 
     //
-    // Emit the first output byte that is produced in each chunk:
+    // Padding ('=', or '.' for url strings) in the 3rd or 4th position ends
+    // the group early; the rest of its 4 positions is skipped.
     //
-       ret.push_back(static_cast<std::string::value_type>( ( (pos_of_char(encoded_string.at(pos+0)) ) << 2 ) + ( (pos_of_char_1 & 0x30 ) >> 4)));
-
-       if ( ( pos + 2 < length_of_string  )       &&  // Check for data that is not padded with equal signs (which is allowed by RFC 2045)
-              encoded_string.at(pos+2) != '='     &&
-              encoded_string.at(pos+2) != '.'         // accept URL-safe base 64 strings, too, so check for '.' also.
-          )
-       {
-       //
-       // Emit a chunk's second byte (which might not be produced in the last chunk).
-       //
-          unsigned int pos_of_char_2 = pos_of_char(encoded_string.at(pos+2) );
-          ret.push_back(static_cast<std::string::value_type>( (( pos_of_char_1 & 0x0f) << 4) + (( pos_of_char_2 & 0x3c) >> 2)));
-
-          if ( ( pos + 3 < length_of_string )     &&
-                 encoded_string.at(pos+3) != '='  &&
-                 encoded_string.at(pos+3) != '.'
-             )
-          {
-          //
-          // Emit a chunk's third byte (which might not be produced in the last chunk).
-          //
-             ret.push_back(static_cast<std::string::value_type>( ( (pos_of_char_2 & 0x03 ) << 6 ) + pos_of_char(encoded_string.at(pos+3))   ));
+       if ((chr == '=' || chr == '.') && in_quad >= 2) {
+          out[written++] = static_cast<unsigned char>((quad[0] << 2) | (quad[1] >> 4));
+          if (in_quad == 3) {
+             out[written++] = static_cast<unsigned char>((quad[1] << 4) | (quad[2] >> 2));
           }
+          skip = 3 - in_quad;
+          in_quad = 0;
+          try_blocks = decode_blocks != nullptr;
+          continue;
        }
 
-       pos += 4;
+       throw std::runtime_error("Input is not valid base64-encoded data.");
+    }
+
+ //
+ // An unpadded last group (allowed by RFC 2045) still yields its bytes;
+ // a single leftover character can't encode any.
+ //
+    if (in_quad == 1) {
+       throw std::runtime_error("Input is not valid base64-encoded data.");
+    }
+    if (in_quad >= 2) {
+       out[written++] = static_cast<unsigned char>((quad[0] << 2) | (quad[1] >> 4));
+       if (in_quad == 3) {
+          out[written++] = static_cast<unsigned char>((quad[1] << 4) | (quad[2] >> 2));
+       }
     }
 
+    ret.resize(written);
     return ret;
 }
 
@@ -0,0 +1,228 @@
+#include "blob_cache.h"
+#include "atomic_file.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace overwatch {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[4] = {'O', 'W', 'B', 'C'};
+constexpr uint32_t kVersion = 3;   // 2: pattern index instead of name, 3: entropy score
+
+// Largest string accepted from a cache file; blobs themselves are at most 1 MB
+constexpr uint32_t kMaxFieldLength = 1024 * 1024;
+
+void writeU32(std::ostream& out, uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool readU32(std::istream& in, uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readString(std::istream& in, std::string& value) {
+    uint32_t length;
+    if (!readU32(in, length) || length > kMaxFieldLength) {
+        return false;
+    }
+    value.resize(length);
+    return static_cast<bool>(in.read(value.data(), length));
+}
+
+} // namespace
+
+BlobCache::BlobCache(const std::string& dir, uint64_t pattern_set_hash, size_t memory_entries)
+    : dir_((fs::path(dir) / hex(pattern_set_hash)).string()),
+      pattern_set_hash_(pattern_set_hash),
+      memory_entries_(std::max<size_t>(1, memory_entries)) {
+    std::error_code ec;
+
+    // Other pattern sets may come back (a reverted change) or be in use by another
+    // process, so only those unused for a long time are dropped
+    auto stale_before = fs::file_time_type::clock::now() - kStaleAfter;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_directory(entry_ec) || it->path().filename() == hex(pattern_set_hash)) {
+            continue;
+        }
+        auto used = it->last_write_time(entry_ec);
+        if (!entry_ec && used < stale_before) {
+            spdlog::info("Dropping stale blob cache of another pattern set: {}", it->path().string());
+            fs::remove_all(it->path(), entry_ec);
+        }
+    }
+
+    fs::create_directories(dir_, ec);
+    if (ec) {
+        spdlog::warn("Could not create blob cache directory {}: {}", dir_, ec.message());
+    }
+    touch();
+}
+
+void BlobCache::touch() {
+    std::error_code ec;
+    fs::last_write_time(dir_, fs::file_time_type::clock::now(), ec);
+    touched_ = std::chrono::steady_clock::now();
+}
+
+std::optional<std::vector<Match>> BlobCache::lookup(const std::string& sha, uint64_t profile) {
+    if (!validSha(sha)) {
+        return std::nullopt;
+    }
+    std::string key = sha + "-" + hex(profile);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            hits_++;
+            return it->second->second;
+        }
+    }
+
+    std::vector<Match> matches;
+    if (!readResult(pathFor(key), matches)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        misses_++;
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    hits_++;
+    remember(key, matches);
+    return matches;
+}
+
+void BlobCache::store(const std::string& sha, uint64_t profile, const std::vector<Match>& matches) {
+    if (!validSha(sha)) {
+        return;
+    }
+    std::string key = sha + "-" + hex(profile);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remember(key, matches);
+
+        // A long-running scan keeps its pattern set from looking stale to other processes
+        if (std::chrono::steady_clock::now() - touched_ > std::chrono::hours(1)) {
+            touch();
+        }
+    }
+
+    if (!writeResult(pathFor(key), matches)) {
+        spdlog::debug("Could not write blob cache entry {}", key);
+    }
+}
+
+size_t BlobCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t BlobCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void BlobCache::remember(const std::string& key, std::vector<Match> matches) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->second = std::move(matches);
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.emplace_front(key, std::move(matches));
+    index_[key] = lru_.begin();
+
+    if (lru_.size() > memory_entries_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+bool BlobCache::validSha(const std::string& sha) {
+    // Also keeps the SHA safe to use as a file name
+    if (sha.size() < 4) {
+        return false;
+    }
+    for (char c : sha) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string BlobCache::hex(uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+std::string BlobCache::pathFor(const std::string& key) const {
+    return dir_ + "/" + key.substr(0, 2) + "/" + key;
+}
+
+bool BlobCache::readResult(const std::string& path, std::vector<Match>& matches) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+        !readU32(in, version) || version != kVersion || !readU32(in, count)) {
+        return false;
+    }
+
+    matches.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        Match match;
+        uint32_t line;
+        uint32_t pattern;
+        uint32_t entropy;
+        uint32_t low_entropy;
+        if (!readU32(in, line) || !readU32(in, pattern) || !readU32(in, entropy) || !readU32(in, low_entropy) ||
+            !readString(in, match.matched_text)) {
+            return false;
+        }
+        match.pattern_index = pattern;
+        match.line_number = static_cast<int>(line);
+        std::memcpy(&match.entropy, &entropy, sizeof(entropy));
+        match.low_entropy = low_entropy != 0;
+        matches.push_back(std::move(match));
+    }
+    return true;
+}
+
+bool BlobCache::writeResult(const std::string& path, const std::vector<Match>& matches) {
+    // Replaced in one rename, so readers never see a partial entry
+    return writeFileAtomically(path, [&matches](std::ostream& out) {
+        out.write(kMagic, sizeof(kMagic));
+        writeU32(out, kVersion);
+        writeU32(out, static_cast<uint32_t>(matches.size()));
+        for (const auto& match : matches) {
+            writeU32(out, static_cast<uint32_t>(match.line_number));
+            writeU32(out, static_cast<uint32_t>(match.pattern_index));
+            uint32_t entropy;
+            std::memcpy(&entropy, &match.entropy, sizeof(entropy));
+            writeU32(out, entropy);
+            writeU32(out, match.low_entropy ? 1 : 0);
+            writeU32(out, static_cast<uint32_t>(match.matched_text.size()));
+            out.write(match.matched_text.data(), static_cast<std::streamsize>(match.matched_text.size()));
+        }
+    });
+}
+
+} // namespace overwatch
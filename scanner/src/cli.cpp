@@ -1,10 +1,43 @@
 #include "cli.h"
+#include "file_watcher.h"
+#include "metrics_server.h"
 #include <spdlog/spdlog.h>
 #include <iostream>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include <csignal>
+#include <unistd.h>
 
 namespace overwatch {
 
+namespace {
+
+// Set by SIGTERM/SIGINT; scans drain and the continuous loops exit when they see it
+std::atomic<bool> stop_requested{false};
+
+void onStopSignal(int) {
+    stop_requested = true;
+}
+
+void installStopHandlers() {
+    struct sigaction action {};
+    action.sa_handler = onStopSignal;
+    action.sa_flags = SA_RESETHAND;  // A second signal terminates at once
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+}
+
+} // namespace
+
 CLI::CLI(int argc, char* argv[]) : argc_(argc), argv_(argv) {
 }
 
@@ -15,8 +48,12 @@ Command CLI::stringToCommand(const std::string& cmd) {
     if (cmd == "all") return Command::ALL;
     if (cmd == "random") return Command::RANDOM;
     if (cmd == "continuous" || cmd == "loop") return Command::CONTINUOUS;
+    if (cmd == "daemon") return Command::DAEMON;
     if (cmd == "filter") return Command::FILTER;
     if (cmd == "list") return Command::LIST;
+    if (cmd == "scan-dir") return Command::SCAN_DIR;
+    if (cmd == "patterns") return Command::PATTERNS;
+    if (cmd == "findings") return Command::FINDINGS;
     if (cmd == "help" || cmd == "--help" || cmd == "-h") return Command::HELP;
     return Command::UNKNOWN;
 }
@@ -72,12 +109,24 @@ int CLI::execute() {
         case Command::CONTINUOUS:
             return continuousCommand();
 
+        case Command::DAEMON:
+            return daemonCommand();
+
         case Command::FILTER:
             return filterCommand();
 
         case Command::LIST:
             return listCommand();
 
+        case Command::SCAN_DIR:
+            return scanDirCommand();
+
+        case Command::PATTERNS:
+            return patternsCommand();
+
+        case Command::FINDINGS:
+            return findingsCommand();
+
         case Command::HELP:
             showHelp();
             return 0;
@@ -111,6 +160,7 @@ int CLI::runCommand() {
     query.max_repos = max_repos;
 
     runScan(query);
+    MetricsRegistry::global().printSummary(std::cout);
     return 0;
 }
 
@@ -129,6 +179,10 @@ int CLI::addCommand() {
     query.name = options_["name"];
     query.query = options_["query"];
     query.max_repos = options_.count("max-repos") ? std::stoi(options_["max-repos"]) : 5;
+    if (options_.count("fetch-mode")) {
+        Scanner::parseFetchMode(options_["fetch-mode"]);  // Reject typos before saving
+        query.fetch_mode = options_["fetch-mode"];
+    }
 
     // Parse tags (can have multiple --tag flags, but for simplicity we'll just take one)
     if (options_.count("tag")) {
@@ -176,12 +230,9 @@ int CLI::allCommand() {
     }
 
     spdlog::info("Running all {} queries from bank", queries.size());
+    runBatch(queries, bank);
 
-    for (const auto& query : queries) {
-        spdlog::info("\n--- Running: {} ---", query.name);
-        runScan(query);
-    }
-
+    MetricsRegistry::global().printSummary(std::cout);
     return 0;
 }
 
@@ -190,9 +241,10 @@ int CLI::randomCommand() {
     bank.load("data/query_bank.yaml");
 
     try {
-        Query query = bank.getRandomQuery();
-        spdlog::info("Randomly selected: {}", query.name);
-        runScan(query);
+        Query query = bank.nextQuery();
+        spdlog::info("Selected: {}{}", query.name, yieldSummary(query));
+        runScan(query, &bank);
+        MetricsRegistry::global().printSummary(std::cout);
         return 0;
     } catch (const std::exception& e) {
         spdlog::error("Error: {}", e.what());
@@ -201,27 +253,41 @@ int CLI::randomCommand() {
 }
 
 int CLI::continuousCommand() {
-    QueryBank bank;
-    bank.load("data/query_bank.yaml");
+    return scanForever(false);
+}
 
-    if (bank.getAllQueries().empty()) {
+int CLI::daemonCommand() {
+    return scanForever(true);
+}
+
+int CLI::scanForever(bool reload) {
+    // Snapshots are taken with atomic_load at the start of each scan, so a reload
+    // swaps in new ones while the scan in flight finishes on what it started with
+    auto bank = std::make_shared<QueryBank>();
+    bank->load("data/query_bank.yaml");
+
+    if (bank->getAllQueries().empty()) {
         spdlog::error("Query bank is empty - cannot run continuous mode");
         return 1;
     }
 
-    // Get GitHub token
-    const char* token_env = std::getenv("GITHUB_TOKEN");
-    std::string token = token_env ? token_env : "";
+    // Get GitHub tokens
+    std::vector<std::string> tokens = TokenPool::loadFromEnvironment();
 
-    if (token.empty()) {
+    if (tokens.empty()) {
         spdlog::warn("No GITHUB_TOKEN found - using unauthenticated API (lower rate limits)");
         spdlog::warn("Set your token: export GITHUB_TOKEN=\"ghp_...\"");
+    } else if (tokens.size() > 1) {
+        spdlog::info("Using a pool of {} GitHub tokens", tokens.size());
     }
 
-    // Validate token ONCE at startup (not on every scan)
-    if (!token.empty()) {
-        GitHubClient temp_client(token);
-        if (!temp_client.validateToken()) {
+    // One client for the whole run so its connections stay warm between scans
+    GitHubClient client(tokens);
+    configureClient(client);
+
+    // Validate tokens ONCE at startup (not on every scan); a replay sends nothing to validate
+    if (!tokens.empty() && !options_.count("replay")) {
+        if (!client.validateToken()) {
             spdlog::error("Failed to validate GitHub token. Please check:");
             spdlog::error("  1. Token is not expired: https://github.com/settings/tokens");
             spdlog::error("  2. Token has 'public_repo' scope");
@@ -230,7 +296,7 @@ int CLI::continuousCommand() {
         }
 
         // Check rate limit once
-        auto rate_data = temp_client.getRateLimit();
+        auto rate_data = client.getRateLimit();
         int remaining = rate_data["rate"]["remaining"];
         int limit = rate_data["rate"]["limit"];
         spdlog::info("API rate limit: {}/{} requests remaining", remaining, limit);
@@ -242,27 +308,83 @@ int CLI::continuousCommand() {
     }
 
     // Load patterns once for all scans
-    SecretDetector detector;
-    detector.loadPatterns("config/patterns.yaml");
+    auto detector = std::make_shared<SecretDetector>(matcherEngine());
+    configureDetector(*detector);
+
+    // Long runs are watched from outside rather than through an end-of-run summary
+    std::unique_ptr<MetricsServer> metrics;
+    if (options_.count("metrics-port")) {
+        std::string address = options_.count("metrics-address") ? options_["metrics-address"] : "127.0.0.1";
+        metrics = std::make_unique<MetricsServer>(MetricsRegistry::global(), address,
+                                                  std::stoi(options_["metrics-port"]));
+    }
 
-    spdlog::info("Starting continuous random scanning mode");
-    spdlog::info("Press Ctrl+C to stop");
-    spdlog::info("Query bank has {} queries loaded", bank.getAllQueries().size());
+    // Changed files are parsed and compiled on the watcher's thread, never on the scan path;
+    // a file that fails to load leaves the running set in place
+    std::unique_ptr<FileWatcher> watcher;
+    if (reload) {
+        watcher = std::make_unique<FileWatcher>(std::vector<FileWatcher::Watch>{
+            {"config/patterns.yaml", [this, &detector]() {
+                auto fresh = std::make_shared<SecretDetector>(matcherEngine());
+                try {
+                    configureDetector(*fresh);
+                } catch (const std::exception& e) {
+                    spdlog::error("Keeping the current patterns, the new ones failed to load: {}", e.what());
+                    return;
+                }
+                std::atomic_store(&detector, fresh);
+                spdlog::info("Reloaded {} patterns, used from the next scan", fresh->patterns().size());
+            }},
+            {"data/query_bank.yaml", [&bank]() {
+                auto fresh = std::make_shared<QueryBank>();
+                try {
+                    fresh->load("data/query_bank.yaml");
+                } catch (const std::exception& e) {
+                    spdlog::error("Keeping the current query bank, the new one failed to load: {}", e.what());
+                    return;
+                }
+                if (fresh->getAllQueries().empty()) {
+                    spdlog::warn("Keeping the current query bank, the new one is empty");
+                    return;
+                }
+                std::atomic_store(&bank, fresh);
+                spdlog::info("Reloaded query bank with {} queries", fresh->getAllQueries().size());
+            }},
+        });
+    }
+
+    installStopHandlers();
+
+    spdlog::info("Starting {} random scanning mode", reload ? "daemon" : "continuous");
+    spdlog::info("Press Ctrl+C or send SIGTERM to stop once in-flight repositories finish");
+    spdlog::info("Query bank has {} queries loaded", bank->getAllQueries().size());
     spdlog::info("");
 
     int scan_count = 0;
-    while (true) {
+    std::shared_ptr<QueryBank> previous_bank;
+    while (!stop_requested) {
+        std::shared_ptr<QueryBank> current_bank = std::atomic_load(&bank);
+        std::shared_ptr<SecretDetector> current_detector = std::atomic_load(&detector);
+
+        // A reloaded bank read query_state.yaml while the last scan could still be
+        // recording into the old one; between scans nothing writes to either, so
+        // the old bank's cursors and yields are handed over here
+        if (previous_bank && current_bank != previous_bank) {
+            current_bank->adoptState(*previous_bank);
+        }
+        previous_bank = current_bank;
+
         try {
-            // Pick a random query
-            Query query = bank.getRandomQuery();
+            // Pick the query most likely to pay off (with some exploration)
+            Query query = current_bank->nextQuery();
             scan_count++;
 
             spdlog::info("=== Scan #{} ===", scan_count);
-            spdlog::info("Randomly selected: {}", query.name);
+            spdlog::info("Selected: {}{}", query.name, yieldSummary(query));
             spdlog::info("");
 
             // Run the scan (reusing detector)
-            runScanNoValidate(query, token, detector);
+            runScanNoValidate(query, client, *current_detector, current_bank.get());
 
             spdlog::info("");
             spdlog::info("Completed scan #{}. Starting next scan...", scan_count);
@@ -274,6 +396,8 @@ int CLI::continuousCommand() {
         }
     }
 
+    spdlog::info("Stopped after {} scans, findings flushed", scan_count);
+    MetricsRegistry::global().printSummary(std::cout);
     return 0;
 }
 
@@ -297,12 +421,9 @@ int CLI::filterCommand() {
     }
 
     spdlog::info("Found {} queries with tag '{}'", queries.size(), tag);
+    runBatch(queries, bank);
 
-    for (const auto& query : queries) {
-        spdlog::info("\n--- Running: {} ---", query.name);
-        runScan(query);
-    }
-
+    MetricsRegistry::global().printSummary(std::cout);
     return 0;
 }
 
@@ -328,73 +449,522 @@ int CLI::listCommand() {
             if (i < query.tags.size() - 1) std::cout << ", ";
         }
         std::cout << "\n";
-        std::cout << "      Max repos: " << query.max_repos << "\n\n";
+        std::cout << "      Max repos: " << query.max_repos << "\n";
+        if (!query.fetch_mode.empty()) {
+            std::cout << "      Fetch mode: " << query.fetch_mode << "\n";
+        }
+        if (query.yield.runs > 0) {
+            std::cout << "      Yield:" << yieldSummary(query) << "\n";
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
+
+int CLI::scanDirCommand() {
+    if (positional_args_.empty()) {
+        spdlog::error("No directory provided");
+        spdlog::info("Usage: overwatch scan-dir <path> [--corpus] [--output findings.jsonl]");
+        return 1;
+    }
+
+    int walk_threads = options_.count("walk-threads") ? std::max(1, std::stoi(options_["walk-threads"])) : 0;
+    LocalDirectorySource source(positional_args_[0], options_.count("corpus") > 0, walk_threads);
+
+    SecretDetector detector(matcherEngine());
+    configureDetector(detector);
+
+    // Files are read straight from disk: no archives, no cap on candidates, one reader per core
+    ScanConfig config = scanConfig();
+    config.fetch_mode = FetchMode::CONTENTS;
+    if (!options_.count("max-tree-files")) {
+        config.max_tree_files = std::numeric_limits<int>::max();
+    }
+    if (!options_.count("fetch-concurrency")) {
+        config.fetch_concurrency = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    // Every run rescans everything: a throwaway index instead of data/scanned_repos.idx
+    std::filesystem::path index_path = std::filesystem::temp_directory_path() /
+                                       ("overwatch_scan_dir_" + std::to_string(getpid()) + ".idx");
+    // Never the bot's input: findings of local directories name repositories that don't exist
+    std::string output = options_.count("output") ? options_["output"] : "data/scan_dir_findings.jsonl";
+    FindingsWriter file(output, outputConfig());
+
+    ScanStats stats;
+    auto start = std::chrono::steady_clock::now();
+    {
+        RepoIndex index(index_path.string());
+        Scanner scanner(source, detector, index, file, config);
+        stats = scanner.run("", 0);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::error_code ec;
+    std::filesystem::remove(index_path, ec);
+    std::filesystem::remove(index_path.string() + ".lock", ec);
+
+    spdlog::info("Scanned {} repositories from {} in {:.2f}s, findings in {}",
+                 stats.scanned, positional_args_[0], seconds, output);
+    MetricsRegistry::global().printSummary(std::cout);
+    return 0;
+}
+
+int CLI::patternsCommand() {
+    SecretDetector detector(matcherEngine());
+    configureDetector(detector);
+
+    if (!options_.count("profile")) {
+        for (const auto& pattern : detector.patterns()) {
+            std::cout << "  " << pattern.name << "\n";
+            std::cout << "      Regex: " << pattern.regex << "\n";
+            std::cout << "      Prefilter: " << (pattern.prefilter.empty() ? "(none)" : pattern.prefilter) << "\n";
+            if (pattern.min_entropy > 0) {
+                std::cout << "      Min entropy: " << pattern.min_entropy << " bits/char\n";
+            }
+            std::cout << "      Files: ";
+            for (size_t i = 0; i < pattern.files.size(); i++) {
+                std::cout << pattern.files[i] << (i + 1 < pattern.files.size() ? ", " : "");
+            }
+            std::cout << "\n\n";
+        }
+        return 0;
+    }
+
+    // Every file under the corpus, up to the size a live scan would fetch, scanned on this thread
+    // so each pattern's time isn't inflated by others competing for the core
+    LocalDirectorySource source(options_["profile"], options_.count("corpus") > 0);
+    std::vector<Repository> repos;
+    source.searchRepositoriesPaged("", 0, SearchOptions(), [&](SearchPage& page) {
+        repos.insert(repos.end(), page.repositories.begin(), page.repositories.end());
+        return true;
+    });
+
+    constexpr size_t kChunk = 256;
+    int readers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    size_t files = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    ScanContext context;   // Scratch reused like a scan worker's, so costs match a live scan
+    for (const auto& repo : repos) {
+        std::vector<std::string> paths;
+        for (const auto& entry : source.getTree(repo.owner, repo.name, "").entries) {
+            if (entry.type == "blob" && entry.size <= Scanner::kMaxBlobSize) {
+                paths.push_back(entry.path);
+            }
+        }
+
+        for (size_t offset = 0; offset < paths.size(); offset += kChunk) {
+            size_t end = std::min(paths.size(), offset + kChunk);
+            std::vector<std::string> chunk(paths.begin() + static_cast<std::ptrdiff_t>(offset),
+                                           paths.begin() + static_cast<std::ptrdiff_t>(end));
+            auto contents = source.getFileContents(repo.owner, repo.name, chunk, readers);
+
+            for (size_t i = 0; i < chunk.size(); i++) {
+                if (!contents[i]) {
+                    continue;
+                }
+                std::string filename = std::filesystem::path(chunk[i]).filename().string();
+                detector.scanContent(contents[i]->content, filename, &context);
+                files++;
+                bytes += contents[i]->content.size();
+            }
+        }
+        context.reset();
     }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+    std::vector<PatternCost> costs = detector.patternCosts();
+    std::sort(costs.begin(), costs.end(), [](const PatternCost& a, const PatternCost& b) {
+        return a.total_nanos > b.total_nanos;
+    });
+
+    size_t width = 7;
+    for (const auto& cost : costs) {
+        width = std::max(width, cost.name.size());
+    }
+
+    std::cout << "\nScanned " << files << " files (" << bytes / 1024 << " KiB) in " << std::fixed
+              << std::setprecision(2) << seconds << "s with the " << detector.engineName() << " engine\n\n";
+    std::cout << std::left << std::setw(static_cast<int>(width)) << "Pattern" << std::right
+              << std::setw(8) << "files" << std::setw(9) << "matches" << std::setw(11) << "total"
+              << std::setw(11) << "mean" << std::setw(11) << "p99" << std::setw(11) << "max"
+              << std::setw(12) << "over budget" << std::setw(13) << "low entropy" << "\n";
+    for (const auto& cost : costs) {
+        std::cout << std::left << std::setw(static_cast<int>(width)) << cost.name << std::right
+                  << std::setw(8) << cost.files << std::setw(9) << cost.matches
+                  << std::setw(11) << formatDuration(cost.total_nanos)
+                  << std::setw(11) << formatDuration(cost.files ? cost.total_nanos / cost.files : 0)
+                  << std::setw(11) << formatDuration(cost.p99_nanos)
+                  << std::setw(11) << formatDuration(cost.max_nanos)
+                  << std::setw(12) << cost.over_budget << std::setw(13) << cost.low_entropy << "\n";
+    }
+    std::cout << "\nfiles: files the pattern ran over (anchored patterns only where their literal occurs)\n";
+    std::cout << "low entropy: matches under the pattern's min_entropy (included in matches)\n";
     return 0;
 }
 
-void CLI::runScan(const Query& query) {
-    // Get GitHub token
-    const char* token_env = std::getenv("GITHUB_TOKEN");
-    std::string token = token_env ? token_env : "";
+int CLI::findingsCommand() {
+    std::string action = positional_args_.empty() ? "status" : positional_args_[0];
+    FindingsStore store("data/findings", outputConfig());
+
+    if (action == "status") {
+        uint64_t end = store.endSequence();
+        uint64_t next = store.cursor();
+        std::cout << "  Segments: " << store.segments() << "\n";
+        std::cout << "  Findings stored: " << end << "\n";
+        std::cout << "  Consumed: " << std::min(end, next) << "\n";
+        std::cout << "  Pending: " << end - std::min(end, next) << "\n";
+        return 0;
+    }
+
+    if (action == "export") {
+        // Appends, like the scanner used to, so a consumer that trims the
+        // file keeps what it hasn't processed yet
+        uint64_t from = options_.count("all") ? 0 : store.cursor();
+        std::vector<StoredFinding> records = store.read(from);
+        std::string output = options_.count("output") ? options_["output"] : "data/findings.jsonl";
+        {
+            std::ofstream out(output, std::ios::app);
+            for (const auto& record : records) {
+                out << "{\"seq\":" << record.sequence << "," << record.json.substr(1) << "\n";
+            }
+            if (!out) {
+                spdlog::error("Failed to write {}", output);
+                return 1;
+            }
+        }
+        spdlog::info("Exported {} findings to {}", records.size(), output);
+
+        if (options_.count("ack") && !records.empty()) {
+            store.acknowledge(records.back().sequence + 1);
+            store.compact();
+        }
+        return 0;
+    }
+
+    if (action == "ack") {
+        if (positional_args_.size() < 2) {
+            spdlog::error("No sequence provided");
+            spdlog::info("Usage: overwatch findings ack <seq>");
+            return 1;
+        }
+        store.acknowledge(std::stoull(positional_args_[1]) + 1);
+        store.compact();
+        spdlog::info("{} findings processed so far", store.cursor());
+        return 0;
+    }
+
+    if (action == "compact") {
+        store.compact();
+        return 0;
+    }
+
+    spdlog::error("Unknown findings action: {}", action);
+    spdlog::info("Usage: overwatch findings [status|export|ack <seq>|compact]");
+    return 1;
+}
+
+std::unique_ptr<GitHubClient> CLI::connect() {
+    // Get GitHub tokens
+    std::vector<std::string> tokens = TokenPool::loadFromEnvironment();
 
-    if (token.empty()) {
+    if (tokens.empty()) {
         spdlog::warn("No GITHUB_TOKEN found - using unauthenticated API (lower rate limits)");
         spdlog::warn("Set your token: export GITHUB_TOKEN=\"ghp_...\"");
+    } else if (tokens.size() > 1) {
+        spdlog::info("Using a pool of {} GitHub tokens", tokens.size());
     }
 
     // Create GitHub client
-    GitHubClient client(token);
+    auto client = std::make_unique<GitHubClient>(tokens);
+    configureClient(*client);
 
-    // Validate token if provided
-    if (!token.empty() && !client.validateToken()) {
-        spdlog::error("Failed to validate GitHub token. Please check:");
-        spdlog::error("  1. Token is not expired: https://github.com/settings/tokens");
-        spdlog::error("  2. Token has 'public_repo' scope");
-        spdlog::error("  3. Token format is correct (starts with ghp_)");
-        throw std::runtime_error("Invalid GitHub token");
+    // A replay sends nothing, so there are no tokens or quota to check
+    if (options_.count("replay")) {
+        spdlog::info("Replaying recorded responses from {}", options_["replay"]);
+    } else {
+        // Validate tokens if provided
+        if (!tokens.empty() && !client->validateToken()) {
+            spdlog::error("Failed to validate GitHub token. Please check:");
+            spdlog::error("  1. Token is not expired: https://github.com/settings/tokens");
+            spdlog::error("  2. Token has 'public_repo' scope");
+            spdlog::error("  3. Token format is correct (starts with ghp_)");
+            throw std::runtime_error("Invalid GitHub token");
+        }
+
+        // Check rate limit
+        auto rate_data = client->getRateLimit();
+        int remaining = rate_data["rate"]["remaining"];
+        int limit = rate_data["rate"]["limit"];
+        spdlog::info("API rate limit: {}/{} requests remaining", remaining, limit);
+
+        if (!tokens.empty() && limit == 60 * static_cast<int>(client->tokenPool().size())) {
+            spdlog::warn("Token might not be working - using unauthenticated rate limit");
+            spdlog::warn("Authenticated tokens should have 5000 requests/hour");
+        }
+
+        if (remaining < 20) {
+            spdlog::warn("Low on API quota! Only {} requests remaining", remaining);
+        }
+    }
+
+    return client;
+}
+
+void CLI::runScan(const Query& query, QueryBank* bank) {
+    std::unique_ptr<GitHubClient> client = connect();
+
+    // Create scanner components
+    SecretDetector detector(matcherEngine());
+    configureDetector(detector);
+
+    runScanNoValidate(query, *client, detector, bank);
+}
+
+void CLI::runBatch(const std::vector<Query>& queries, QueryBank& bank) {
+    // Client, token checks, patterns and the scanned index are set up once for every query
+    std::unique_ptr<GitHubClient> client = connect();
+    SecretDetector detector(matcherEngine());
+    configureDetector(detector);
+
+    int parallel = options_.count("query-workers") ? std::max(1, std::stoi(options_["query-workers"])) : 4;
+
+    // The fetch mode is fixed for a scanner's whole pipeline, so queries that set
+    // their own run as separate batches, in order of first appearance
+    std::vector<std::pair<FetchMode, std::vector<const Query*>>> groups;
+    for (const auto& query : queries) {
+        FetchMode mode = effectiveConfig(query).fetch_mode;
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const auto& g) { return g.first == mode; });
+        if (group == groups.end()) {
+            groups.push_back({mode, {}});
+            group = groups.end() - 1;
+        }
+        group->second.push_back(&query);
     }
 
-    // Check rate limit
-    auto rate_data = client.getRateLimit();
-    int remaining = rate_data["rate"]["remaining"];
-    int limit = rate_data["rate"]["limit"];
-    spdlog::info("API rate limit: {}/{} requests remaining", remaining, limit);
+    for (const auto& [mode, members] : groups) {
+        std::vector<ScanJob> jobs;
+        std::vector<bool> incremental;
+        for (const Query* query : members) {
+            spdlog::info("Queued: {}", query->name);
+            bool tracked = false;
+            jobs.push_back(scanJob(*query, &bank, tracked));
+            incremental.push_back(tracked);
+        }
+
+        Scanner scanner(*client, detector, scannedIndex(), findingsSink(), effectiveConfig(*members[0]),
+                        blobCache(detector));
+        uint64_t requests_before = client->requestsSent();
+        std::vector<ScanStats> stats = scanner.runBatch(jobs, parallel);
+        uint64_t requests = client->requestsSent() - requests_before;
+
+        // Searches share one client, so the batch's calls are split by what each
+        // query cost: a search page or so plus its share of scanned repositories
+        double weight_total = 0;
+        for (const auto& job_stats : stats) {
+            weight_total += 1 + job_stats.scanned;
+        }
 
-    if (!token.empty() && limit == 60) {
-        spdlog::warn("Token might not be working - using unauthenticated rate limit");
-        spdlog::warn("Authenticated tokens should have 5000 requests/hour");
+        for (size_t i = 0; i < members.size(); i++) {
+            if (incremental[i] && !stats[i].newest_pushed_at.empty()) {
+                bank.recordCursor(members[i]->id, stats[i].newest_pushed_at);
+            }
+            if (!options_.count("replay")) {
+                auto share = static_cast<uint64_t>(std::llround(requests * (1 + stats[i].scanned) / weight_total));
+                bank.recordYield(members[i]->id, stats[i].scanned, stats[i].findings, share);
+            }
+        }
     }
+}
 
-    if (remaining < 20) {
-        spdlog::warn("Low on API quota! Only {} requests remaining", remaining);
+ScanConfig CLI::effectiveConfig(const Query& query) {
+    // A query's own fetch mode applies unless --fetch-mode overrides it
+    ScanConfig config = scanConfig();
+    if (!query.fetch_mode.empty() && !options_.count("fetch-mode")) {
+        config.fetch_mode = Scanner::parseFetchMode(query.fetch_mode);
     }
+    return config;
+}
 
-    // Create scanner components
-    SecretDetector detector;
-    detector.loadPatterns("config/patterns.yaml");
-    Scanner scanner(client, detector, "data/findings.jsonl");
+ScanJob CLI::scanJob(const Query& query, QueryBank* bank, bool& incremental) {
+    // Bank queries run incrementally: after the first run, only ask for
+    // repositories pushed since the newest one seen, oldest first, so each
+    // run continues where the last one stopped
+    ScanJob job;
+    job.query = query.query;
+    job.max_repos = query.max_repos;
+    if (options_.count("search-workers")) {
+        job.options.shard_workers = std::max(0, std::stoi(options_["search-workers"]));
+    }
 
-    // Run scan
-    spdlog::info("Starting scan: {}", query.name.empty() ? query.query : query.name);
-    scanner.run(query.query, query.max_repos);
-    spdlog::info("Scan complete!");
+    // Recordings and replays always search from scratch, so both send the same requests
+    incremental = bank != nullptr && query.id > 0 && !options_.count("full") &&
+                  !options_.count("record") && !options_.count("replay") &&
+                  query.query.find("pushed:") == std::string::npos;
+
+    if (incremental) {
+        job.options.sort = "updated";
+        if (query.cursor.empty()) {
+            job.options.order = "desc";
+        } else {
+            job.query += " pushed:>=" + query.cursor;
+            job.options.order = "asc";
+            // Shards deliver in no set order and a drain leaves windows unfetched, so the
+            // cursor could pass repositories never seen; oldest-first pages never do that,
+            // and whatever is past the 1000-result cap is picked up by the next run
+            job.options.shard_workers = 0;
+            spdlog::info("Only repositories pushed since {}", query.cursor);
+        }
+    }
+    return job;
 }
 
-void CLI::runScanNoValidate(const Query& query, const std::string& token, SecretDetector& detector) {
-    // Create GitHub client (without validation)
-    GitHubClient client(token);
+void CLI::runScanNoValidate(const Query& query, GitHubClient& client, SecretDetector& detector,
+                            QueryBank* bank) {
+    // Use pre-validated client and pre-loaded detector (patterns already compiled)
+    Scanner scanner(client, detector, scannedIndex(), findingsSink(), effectiveConfig(query),
+                    blobCache(detector));
 
-    // Use pre-loaded detector (patterns already compiled)
-    Scanner scanner(client, detector, "data/findings.jsonl");
+    bool incremental = false;
+    ScanJob job = scanJob(query, bank, incremental);
 
     // Run scan
     spdlog::info("Starting scan: {}", query.name.empty() ? query.query : query.name);
-    scanner.run(query.query, query.max_repos);
+    uint64_t requests_before = client.requestsSent();
+    ScanStats stats = scanner.run(job.query, job.max_repos, job.options);
+
+    // Replays would teach the scheduler about recorded runs, not live ones
+    if (bank != nullptr && query.id > 0 && !options_.count("replay")) {
+        bank->recordYield(query.id, stats.scanned, stats.findings, client.requestsSent() - requests_before);
+    }
+
+    if (incremental && !stats.newest_pushed_at.empty()) {
+        bank->recordCursor(query.id, stats.newest_pushed_at);
+    }
     spdlog::info("Scan complete!");
 }
 
+RepoIndex& CLI::scannedIndex() {
+    // Opened on first use and kept for every scan this process runs
+    if (!scanned_index_) {
+        scanned_index_ = std::make_unique<RepoIndex>("data/scanned_repos.idx", "data/scanned_repos.txt");
+    }
+    return *scanned_index_;
+}
+
+void CLI::configureClient(GitHubClient& client) {
+    if (!options_.count("no-http-cache")) {
+        uint64_t max_bytes = HttpCache::kDefaultMaxBytes;
+        if (options_.count("http-cache-mb")) {
+            max_bytes = std::stoull(options_["http-cache-mb"]) << 20;
+        }
+        client.enableHttpCache("data/http_cache", max_bytes);
+    }
+
+    if (options_.count("replay")) {
+        client.replayFixtures(options_["replay"]);
+    } else if (options_.count("record")) {
+        client.recordFixtures(options_["record"]);
+    }
+}
+
+BlobCache* CLI::blobCache(const SecretDetector& detector) {
+    if (options_.count("no-blob-cache")) {
+        return nullptr;
+    }
+
+    // Reopened only when the pattern set changes, which also drops the stale results
+    if (!blob_cache_ || blob_cache_->patternSetHash() != detector.patternSetHash()) {
+        blob_cache_ = std::make_unique<BlobCache>("data/blob_cache", detector.patternSetHash());
+    }
+    return blob_cache_.get();
+}
+
+std::string CLI::yieldSummary(const Query& query) {
+    if (query.yield.runs <= 0) {
+        return " (never scored)";
+    }
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), " (%.3f new repos+findings per API call over %.1f recent runs)",
+                  query.yield.value(), query.yield.runs);
+    return buffer;
+}
+
+std::string CLI::matcherEngine() {
+    return options_.count("engine") ? options_["engine"] : "auto";
+}
+
+void CLI::configureDetector(SecretDetector& detector) {
+    detector.loadPatterns("config/patterns.yaml");
+
+    // A runaway regex costs one file's worth of budget instead of stalling a worker
+    long budget_ms = options_.count("pattern-budget-ms") ? std::stol(options_["pattern-budget-ms"]) : 250;
+    detector.setPatternBudget(std::chrono::milliseconds(std::max(0L, budget_ms)));
+}
+
+ScanConfig CLI::scanConfig() {
+    ScanConfig config;
+    config.stop = &stop_requested;
+
+    if (options_.count("fetch-concurrency")) {
+        config.fetch_concurrency = std::max(1, std::stoi(options_["fetch-concurrency"]));
+    }
+
+    if (options_.count("no-tree")) {
+        config.use_tree = false;
+    }
+
+    if (options_.count("fetch-mode")) {
+        config.fetch_mode = Scanner::parseFetchMode(options_["fetch-mode"]);
+    }
+
+    if (options_.count("tarball-min-files")) {
+        config.tarball_min_files = std::max(1, std::stoi(options_["tarball-min-files"]));
+    }
+
+    if (options_.count("max-tree-files")) {
+        config.max_tree_files = std::max(1, std::stoi(options_["max-tree-files"]));
+    }
+
+    if (options_.count("workers")) {
+        config.scan_workers = std::max(1, std::stoi(options_["workers"]));
+    }
+
+    if (options_.count("queue-size")) {
+        config.queue_capacity = std::max(1, std::stoi(options_["queue-size"]));
+    }
+
+    if (options_.count("keep-low-entropy")) {
+        config.keep_low_entropy = true;
+    }
+
+    return config;
+}
+
+FindingsWriterConfig CLI::outputConfig() {
+    FindingsWriterConfig config;
+    if (options_.count("fsync")) {
+        config.fsync = FindingsWriter::parseFsyncPolicy(options_["fsync"]);
+    }
+    return config;
+}
+
+FindingsSink& CLI::findingsSink() {
+    // Opened on first use and kept for every scan this process runs, so the
+    // store's dedup keys are loaded once
+    if (!findings_sink_) {
+        if (options_.count("store")) {
+            findings_sink_ = std::make_unique<FindingsStore>("data/findings", outputConfig());
+        } else {
+            findings_sink_ = std::make_unique<FindingsWriter>("data/findings.jsonl", outputConfig());
+        }
+    }
+    return *findings_sink_;
+}
+
 void CLI::showHelp() {
     std::cout << "OverWatch Scanner - GitHub Secret Scanner\n\n";
     std::cout << "USAGE:\n";
@@ -406,19 +976,67 @@ void CLI::showHelp() {
     std::cout << "  list                     List all queries in bank\n";
     std::cout << "  all                      Run all queries from bank\n";
     std::cout << "  random                   Run a random query from bank (once)\n";
-    std::cout << "  continuous               Run random queries forever (Ctrl+C to stop)\n";
+    std::cout << "  continuous               Run random queries forever (Ctrl+C or SIGTERM to stop)\n";
+    std::cout << "  daemon                   Like continuous, reloading patterns and query bank when they change\n";
     std::cout << "  filter --tag <tag>       Run queries with specific tag\n";
+    std::cout << "  scan-dir <path>          Scan a directory on disk instead of GitHub\n";
+    std::cout << "  patterns                 List loaded patterns (--profile <dir>: rank them by cost)\n";
+    std::cout << "  findings [action]        Findings store: status, export, ack <seq>, compact\n";
     std::cout << "  help                     Show this help message\n\n";
+    std::cout << "OPTIONS:\n";
+    std::cout << "  --max-repos <n>          Maximum repositories per query (run, add)\n";
+    std::cout << "  --fetch-concurrency <n>  File requests in flight per repository (default: 8)\n";
+    std::cout << "  --no-tree                Probe known root files instead of listing the repo tree\n";
+    std::cout << "  --fetch-mode <mode>      Download files via: auto, contents, tarball, graphql (default: auto; run, add)\n";
+    std::cout << "  --tarball-min-files <n>  Files to fetch before auto mode downloads the archive (default: 16)\n";
+    std::cout << "  --max-tree-files <n>     Candidate files fetched per repository (default: 64)\n";
+    std::cout << "  --workers <n>            Repositories scanned in parallel (default: 4)\n";
+    std::cout << "  --search-workers <n>     Parallel searches when splitting a query past 1000 results (default: 4, 0 = off)\n";
+    std::cout << "  --query-workers <n>      all, filter: bank queries searched at once (default: 4)\n";
+    std::cout << "  --queue-size <n>         Repositories buffered ahead of the scan workers (default: 64)\n";
+    std::cout << "  --full                   Search bank queries from scratch instead of since the last run\n";
+    std::cout << "  --no-http-cache          Don't revalidate search/contents responses with ETags\n";
+    std::cout << "  --http-cache-mb <n>      Cap the HTTP cache at n MB (default: 256)\n";
+    std::cout << "  --no-blob-cache          Fetch and scan every file, even blobs scanned before\n";
+    std::cout << "  --engine <name>          Pattern matcher engine: auto, re2, std (default: auto)\n";
+    std::cout << "  --pattern-budget-ms <n>  Time one pattern may spend on one file before it is skipped (default: 250, 0 = off)\n";
+    std::cout << "  --keep-low-entropy       Report matches under their pattern's min_entropy, flagged, instead of dropping them\n";
+    std::cout << "  --fsync <policy>         Sync findings to disk: never, flush (each batch), always (default: never)\n";
+    std::cout << "  --record <dir>           Save every GitHub response as a fixture in <dir>\n";
+    std::cout << "  --replay <dir>           Answer requests from fixtures in <dir> instead of the network\n";
+    std::cout << "  --corpus                 scan-dir, patterns: <path>/<owner>/<repo> directories are repositories\n";
+    std::cout << "  --walk-threads <n>       scan-dir: threads walking each tree (default: one per core)\n";
+    std::cout << "  --store                  Write findings to the data/findings store instead of data/findings.jsonl\n";
+    std::cout << "  --output <file>          scan-dir: findings file (default: data/scan_dir_findings.jsonl)\n";
+    std::cout << "                           findings export: JSONL file appended to (default: data/findings.jsonl)\n";
+    std::cout << "  --ack                    findings export: mark what was exported as processed\n";
+    std::cout << "  --all                    findings export: every stored finding, not just unprocessed ones\n";
+    std::cout << "  --metrics-port <n>       continuous, daemon: serve Prometheus metrics on http://<address>:<n>/metrics\n";
+    std::cout << "  --metrics-address <ip>   continuous, daemon: address for the metrics endpoint (default: 127.0.0.1)\n\n";
     std::cout << "EXAMPLES:\n";
     std::cout << "  overwatch run \"language:Python stars:<5\"\n";
     std::cout << "  overwatch run \"language:Python stars:<5\" --max-repos 10\n";
+    std::cout << "  overwatch run \"topic:monorepo\" --fetch-mode tarball\n";
+    std::cout << "  overwatch run \"language:Python stars:<5\" --fetch-concurrency 16\n";
     std::cout << "  overwatch add --name \"Low Star Python\" --query \"language:Python stars:<5\" --tag python\n";
     std::cout << "  overwatch delete 3\n";
     std::cout << "  overwatch list\n";
     std::cout << "  overwatch all\n";
     std::cout << "  overwatch random\n";
     std::cout << "  overwatch continuous     # Runs forever until Ctrl+C\n";
-    std::cout << "  overwatch filter --tag python\n\n";
+    std::cout << "  overwatch continuous --metrics-port 9464\n";
+    std::cout << "  overwatch daemon --metrics-port 9464 # Edit config/patterns.yaml to reload\n";
+    std::cout << "  overwatch filter --tag python\n";
+    std::cout << "  overwatch run \"language:Python stars:<5\" --record data/fixtures\n";
+    std::cout << "  overwatch run \"language:Python stars:<5\" --replay data/fixtures\n";
+    std::cout << "  overwatch scan-dir ~/archive --corpus --output backfill.jsonl\n";
+    std::cout << "  overwatch patterns --profile ~/archive --engine std\n";
+    std::cout << "  overwatch continuous --store\n";
+    std::cout << "  overwatch findings export --ack # Hand new findings to bot.py\n\n";
+    std::cout << "ENVIRONMENT:\n";
+    std::cout << "  GITHUB_TOKEN             GitHub API token\n";
+    std::cout << "  GITHUB_TOKENS            Several tokens (comma separated) to share the load\n";
+    std::cout << "  GITHUB_TOKENS_FILE       File with one token per line\n\n";
 }
 
 } 
@@ -0,0 +1,186 @@
+#include "entropy.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace overwatch {
+
+// log2 and reciprocal of every count a vector-scored string can have
+struct CountTables {
+    std::array<float, kMaxVectorEntropyLength + 1> log2{};
+    std::array<float, kMaxVectorEntropyLength + 1> inverse{};
+};
+
+static const CountTables& countTables() {
+    static const CountTables tables = []() {
+        CountTables t;
+        for (size_t k = 1; k <= kMaxVectorEntropyLength; k++) {
+            t.log2[k] = static_cast<float>(std::log2(static_cast<double>(k)));
+            t.inverse[k] = 1.0f / static_cast<float>(k);
+        }
+        return t;
+    }();
+    return tables;
+}
+
+EntropyScore scoreEntropyScalar(std::string_view text) {
+    EntropyScore score;
+    score.length = static_cast<uint32_t>(text.size());
+    if (text.empty()) {
+        return score;
+    }
+
+    // Neighbouring bytes land in different tables, so runs of one byte don't
+    // serialize on a single counter
+    uint32_t counts[4][256] = {};
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    size_t n = text.size();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        counts[0][data[i]]++;
+        counts[1][data[i + 1]]++;
+        counts[2][data[i + 2]]++;
+        counts[3][data[i + 3]]++;
+    }
+    for (; i < n; i++) {
+        counts[0][data[i]]++;
+    }
+
+    double sum = 0;
+    for (int c = 0; c < 256; c++) {
+        uint32_t count = counts[0][c] + counts[1][c] + counts[2][c] + counts[3][c];
+        if (count == 0) {
+            continue;
+        }
+        score.distinct++;
+        double p = static_cast<double>(count) / static_cast<double>(n);
+        sum -= p * std::log2(p);
+
+        if (c >= 'a' && c <= 'z') {
+            score.lower += count;
+        } else if (c >= 'A' && c <= 'Z') {
+            score.upper += count;
+        } else if (c >= '0' && c <= '9') {
+            score.digits += count;
+        } else {
+            score.other += count;
+        }
+    }
+    score.entropy = static_cast<float>(sum);
+
+    return score;
+}
+
+#if defined(__SSE2__)
+
+// Lanes of x within [lo, hi]; bytes >= 0x80 compare as negative and fall outside
+static inline __m128i inRange(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(x, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+// Sum of the 16 byte counters
+static inline uint32_t horizontalSum(__m128i counters) {
+    __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+}
+
+static EntropyScore scoreShort(std::string_view text) {
+    constexpr size_t kMaxBlocks = kMaxVectorEntropyLength / 16;
+    // 16 set lanes then 16 clear ones; loading at 16 - r keeps the first r lanes
+    alignas(16) static const unsigned char kLaneMask[32] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+    EntropyScore score;
+    size_t n = text.size();
+    score.length = static_cast<uint32_t>(n);
+
+    // The string held in registers; lanes past its end are masked out of every count
+    alignas(16) unsigned char buffer[kMaxVectorEntropyLength];
+    size_t blocks = (n + 15) / 16;
+    std::memcpy(buffer, text.data(), n);
+    std::memset(buffer + n, 0, blocks * 16 - n);
+    size_t last = blocks - 1;
+    const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kLaneMask + 16 - (n - last * 16)));
+
+    __m128i block[kMaxBlocks];
+    for (size_t b = 0; b < blocks; b++) {
+        block[b] = _mm_load_si128(reinterpret_cast<const __m128i*>(buffer + b * 16));
+    }
+
+    // Byte counters: each block adds at most 1 per lane, so 16 blocks can't overflow them
+    __m128i lower = _mm_setzero_si128();
+    __m128i upper = _mm_setzero_si128();
+    __m128i digits = _mm_setzero_si128();
+    for (size_t b = 0; b < blocks; b++) {
+        __m128i valid = b == last ? tail : _mm_set1_epi8(-1);
+        lower = _mm_sub_epi8(lower, _mm_and_si128(inRange(block[b], 'a', 'z'), valid));
+        upper = _mm_sub_epi8(upper, _mm_and_si128(inRange(block[b], 'A', 'Z'), valid));
+        digits = _mm_sub_epi8(digits, _mm_and_si128(inRange(block[b], '0', '9'), valid));
+    }
+    score.lower = horizontalSum(lower);
+    score.upper = horizontalSum(upper);
+    score.digits = horizontalSum(digits);
+    score.other = score.length - score.lower - score.upper - score.digits;
+
+    // H = log2(n) - (1/n) * sum over positions of log2(count of that position's byte);
+    // a byte seen k times adds 1/k to the distinct count at each of them
+    const CountTables& tables = countTables();
+    float sum = 0;
+    float distinct = 0;
+    for (size_t i = 0; i < n; i++) {
+        __m128i byte = _mm_set1_epi8(static_cast<char>(buffer[i]));
+        __m128i equal = _mm_and_si128(_mm_cmpeq_epi8(block[last], byte), tail);
+        __m128i counters = _mm_sub_epi8(_mm_setzero_si128(), equal);
+        for (size_t b = 0; b < last; b++) {
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block[b], byte));
+        }
+        uint32_t count = horizontalSum(counters);
+        sum += tables.log2[count];
+        distinct += tables.inverse[count];
+    }
+
+    score.entropy = std::max(0.0f, tables.log2[n] - sum / static_cast<float>(n));
+    score.distinct = static_cast<uint32_t>(std::lround(distinct));
+    return score;
+}
+
+#endif
+
+EntropyScore scoreEntropy(std::string_view text) {
+#if defined(__SSE2__)
+    if (!text.empty() && text.size() <= kMaxVectorEntropyLength) {
+        return scoreShort(text);
+    }
+#endif
+    return scoreEntropyScalar(text);
+}
+
+std::string_view secretValue(std::string_view match) {
+    auto separator = [](char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\'' || c == '"' || c == '`' ||
+               c == ':' || c == '=' || c == ',' || c == ';';
+    };
+
+    size_t best_start = 0;
+    size_t best_length = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= match.size(); i++) {
+        if (i == match.size() || separator(match[i])) {
+            if (i - start > best_length) {
+                best_start = start;
+                best_length = i - start;
+            }
+            start = i + 1;
+        }
+    }
+
+    return best_length == 0 ? match : match.substr(best_start, best_length);
+}
+
+} // namespace overwatch
@@ -0,0 +1,125 @@
+#include "file_dispatch.h"
+#include <algorithm>
+
+namespace overwatch {
+
+FileDispatch::FileDispatch() {
+    suffixes_.emplace_back();
+}
+
+void FileDispatch::add(size_t pattern, const std::vector<std::string>& globs) {
+    for (const auto& glob : globs) {
+        if (glob == "*") {
+            wildcard_.push_back(pattern);
+        } else if (glob.size() > 1 && glob[0] == '*') {
+            // Simple wildcard matching: *.ext
+            addSuffix(std::string_view(glob).substr(1), pattern);
+        } else if (!glob.empty()) {
+            exact_[glob].push_back(pattern);
+        }
+    }
+
+    // Cached results no longer reflect the pattern set
+    std::lock_guard<std::mutex> lock(mutex_);
+    by_name_.clear();
+    entries_.clear();
+}
+
+void FileDispatch::clear() {
+    wildcard_.clear();
+    exact_.clear();
+    suffixes_.assign(1, TrieNode{});
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    by_name_.clear();
+    entries_.clear();
+}
+
+void FileDispatch::addSuffix(std::string_view suffix, size_t pattern) {
+    // Suffixes are stored reversed so a lookup walks the filename from its end
+    uint32_t node = 0;
+    for (auto it = suffix.rbegin(); it != suffix.rend(); ++it) {
+        auto& children = suffixes_[node].children;
+        auto child = std::find_if(children.begin(), children.end(),
+                                  [c = *it](const auto& edge) { return edge.first == c; });
+        if (child != children.end()) {
+            node = child->second;
+            continue;
+        }
+
+        auto next = static_cast<uint32_t>(suffixes_.size());
+        children.emplace_back(*it, next);
+        suffixes_.emplace_back();
+        node = next;
+    }
+    suffixes_[node].patterns.push_back(pattern);
+}
+
+FileDispatch::Entry FileDispatch::resolve(std::string_view filename) const {
+    Entry entry;
+
+    auto exact = exact_.find(std::string(filename));
+    if (exact != exact_.end()) {
+        entry.patterns = exact->second;
+    }
+
+    uint32_t node = 0;
+    for (auto it = filename.rbegin(); it != filename.rend(); ++it) {
+        const auto& children = suffixes_[node].children;
+        auto child = std::find_if(children.begin(), children.end(),
+                                  [c = *it](const auto& edge) { return edge.first == c; });
+        if (child == children.end()) {
+            break;
+        }
+        node = child->second;
+        const auto& hits = suffixes_[node].patterns;
+        entry.patterns.insert(entry.patterns.end(), hits.begin(), hits.end());
+    }
+
+    entry.targeted = !entry.patterns.empty();
+    entry.patterns.insert(entry.patterns.end(), wildcard_.begin(), wildcard_.end());
+
+    std::sort(entry.patterns.begin(), entry.patterns.end());
+    entry.patterns.erase(std::unique(entry.patterns.begin(), entry.patterns.end()), entry.patterns.end());
+
+    // FNV-1a over the indices
+    entry.signature = 0xcbf29ce484222325ULL;
+    for (size_t pattern : entry.patterns) {
+        entry.signature ^= static_cast<uint64_t>(pattern);
+        entry.signature *= 0x100000001b3ULL;
+    }
+    return entry;
+}
+
+const FileDispatch::Entry* FileDispatch::intern(Entry entry) const {
+    // Few distinct pattern lists exist, so files share entries
+    for (const auto& existing : entries_) {
+        if (existing.targeted == entry.targeted && existing.patterns == entry.patterns) {
+            return &existing;
+        }
+    }
+
+    entries_.push_back(std::move(entry));
+    return &entries_.back();
+}
+
+const FileDispatch::Entry& FileDispatch::lookup(std::string_view filename) const {
+    std::string key(filename);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cached = by_name_.find(key);
+    if (cached != by_name_.end()) {
+        return *cached->second;
+    }
+
+    // Bound memory across many repositories; interned entries stay valid
+    if (by_name_.size() >= kMaxCachedNames) {
+        by_name_.clear();
+    }
+
+    const Entry* entry = intern(resolve(filename));
+    by_name_.emplace(std::move(key), entry);
+    return *entry;
+}
+
+} // namespace overwatch
@@ -0,0 +1,133 @@
+#include "file_watcher.h"
+#include <spdlog/spdlog.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace overwatch {
+
+namespace {
+
+std::filesystem::file_time_type modifiedAt(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type{} : mtime;
+}
+
+} // namespace
+
+FileWatcher::FileWatcher(std::vector<Watch> watches) {
+#ifdef __linux__
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("Could not start inotify: ") + std::strerror(errno));
+    }
+#endif
+
+    for (auto& watch : watches) {
+        std::filesystem::path path(watch.path);
+        Entry entry;
+        entry.directory = path.has_parent_path() ? path.parent_path().string() : ".";
+        entry.filename = path.filename().string();
+        entry.mtime = modifiedAt(watch.path);
+        entry.watch = std::move(watch);
+
+#ifdef __linux__
+        // Watching the same directory twice returns the same descriptor
+        entry.descriptor = ::inotify_add_watch(fd_, entry.directory.c_str(),
+                                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (entry.descriptor < 0) {
+            std::string error = std::strerror(errno);
+            ::close(fd_);
+            throw std::runtime_error("Could not watch " + entry.directory + ": " + error);
+        }
+#endif
+        spdlog::info("Watching {} for changes", entry.watch.path);
+        entries_.push_back(std::move(entry));
+    }
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+FileWatcher::~FileWatcher() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void FileWatcher::run() {
+    while (!stop_) {
+        collectEvents();
+
+        auto now = std::chrono::steady_clock::now();
+        for (auto& entry : entries_) {
+            if (!entry.pending || now < entry.due) {
+                continue;
+            }
+            entry.pending = false;
+            spdlog::info("{} changed", entry.watch.path);
+            try {
+                entry.watch.on_change();
+            } catch (const std::exception& e) {
+                spdlog::error("Handling a change to {} failed: {}", entry.watch.path, e.what());
+            }
+        }
+    }
+}
+
+void FileWatcher::collectEvents() {
+    auto due = std::chrono::steady_clock::now() + kSettle;
+
+#ifdef __linux__
+    // Wake up regularly so the destructor never waits long
+    pollfd pfd{fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, 100) <= 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+        if (n <= 0) {
+            return;  // EAGAIN: drained
+        }
+
+        for (ssize_t offset = 0; offset < n;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->len == 0) {
+                continue;
+            }
+
+            for (auto& entry : entries_) {
+                if (entry.descriptor == event->wd && entry.filename == event->name) {
+                    entry.pending = true;
+                    entry.due = due;
+                }
+            }
+        }
+    }
+#else
+    ::poll(nullptr, 0, 250);
+    for (auto& entry : entries_) {
+        auto mtime = modifiedAt(entry.watch.path);
+        if (mtime != entry.mtime) {
+            entry.mtime = mtime;
+            entry.pending = true;
+            entry.due = due;
+        }
+    }
+#endif
+}
+
+} // namespace overwatch
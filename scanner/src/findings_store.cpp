@@ -0,0 +1,513 @@
+#include "findings_store.h"
+#include "atomic_file.h"
+#include "metrics.h"
+#include <spdlog/spdlog.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace overwatch {
+
+namespace {
+
+const char kMagic[8] = {'O', 'W', 'F', 'S', 'E', 'G', '1', '\0'};
+
+// Record header: payload length, CRC-32 of the payload
+constexpr size_t kHeaderSize = 2 * sizeof(uint32_t);
+
+// Larger lengths can only come from a corrupt header
+constexpr uint32_t kMaxRecordSize = 64 * 1024 * 1024;
+
+// Exclusive flock for the lifetime of the scope
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd_(fd) {
+        while (::flock(fd_, LOCK_EX) != 0 && errno == EINTR) {
+        }
+    }
+    ~FileLock() { ::flock(fd_, LOCK_UN); }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+uint64_t fileSize(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+bool writeAt(int fd, const char* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool readAt(int fd, char* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint32_t checksum(const char* data, size_t size) {
+    return static_cast<uint32_t>(::crc32(0L, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(size)));
+}
+
+std::string segmentName(const std::string& dir, uint64_t base, const char* extension) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu%s", static_cast<unsigned long long>(base), extension);
+    return (fs::path(dir) / name).string();
+}
+
+} // namespace
+
+FindingsStore::FindingsStore(const std::string& dir, const FindingsWriterConfig& config)
+    : dir_(dir), config_(config) {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to create findings store " + dir_ + ": " + ec.message());
+    }
+
+    std::string lock_path = (fs::path(dir_) / "lock").string();
+    std::string keys_path = (fs::path(dir_) / "keys").string();
+    lock_fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    keys_fd_ = ::open(keys_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd_ < 0 || keys_fd_ < 0) {
+        std::string error = std::strerror(errno);
+        if (lock_fd_ >= 0) ::close(lock_fd_);
+        if (keys_fd_ >= 0) ::close(keys_fd_);
+        throw std::runtime_error("Failed to open findings store " + dir_ + ": " + error);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        catchUpKeysLocked();
+    }
+    uint64_t end = endSequence();
+    uint64_t next = cursor();
+    spdlog::info("Opened findings store {} ({} findings, {} not yet consumed)", dir_, end,
+                 end - std::min(end, next));
+
+    flusher_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            wake_.wait_for(lock, std::chrono::milliseconds(std::max(1, config_.flush_interval_ms)));
+            if (!pending_.empty()) {
+                flushLocked();
+            }
+        }
+    });
+}
+
+FindingsStore::~FindingsStore() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    flusher_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+    ::close(keys_fd_);
+    ::close(lock_fd_);
+}
+
+uint64_t FindingsStore::findingKey(const Finding& finding) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto feed = [&hash](std::string_view text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        // Field separator, so ("ab", "c") and ("a", "bc") differ
+        hash ^= 0xff;
+        hash *= 0x100000001b3ULL;
+    };
+
+    feed(finding.owner);
+    feed(finding.repo);
+    feed(finding.file);
+    feed(finding.match.matched_text);
+    return hash;
+}
+
+bool FindingsStore::write(const Finding& finding) {
+    static Counter& duplicate_count = MetricsRegistry::global().counter(
+        "overwatch_store_duplicates_total", {}, "Findings dropped because the store already had them");
+
+    uint64_t key = findingKey(finding);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!seen_.insert(key).second) {
+        duplicates_++;
+        duplicate_count.add();
+        return false;
+    }
+
+    char stamp[21];
+    std::time_t now = std::time(nullptr);
+    std::tm utc;
+    gmtime_r(&now, &utc);
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    Pending entry{key, {}};
+    FindingsWriter::appendJson(entry.json, finding, stamp);
+    pending_bytes_ += kHeaderSize + entry.json.size();
+    pending_.push_back(std::move(entry));
+    count_++;
+
+    if (config_.fsync == FsyncPolicy::ALWAYS || pending_bytes_ >= config_.buffer_bytes) {
+        flushLocked();
+    }
+    return true;
+}
+
+void FindingsStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+size_t FindingsStore::written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+size_t FindingsStore::duplicates() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return duplicates_;
+}
+
+void FindingsStore::flushLocked() {
+    static Histogram& flush_time = MetricsRegistry::global().histogram(
+        "overwatch_store_flush_seconds", {}, "Time to append (and sync) one batch of findings to the store");
+    static Counter& duplicate_count = MetricsRegistry::global().counter("overwatch_store_duplicates_total");
+
+    if (pending_.empty()) {
+        return;
+    }
+    ScopedTimer timer(flush_time);
+
+    std::vector<Pending> batch;
+    batch.swap(pending_);
+    pending_bytes_ = 0;
+
+    FileLock file_lock(lock_fd_);
+
+    // Another process may have stored some of these since write() let them through
+    std::vector<uint64_t> fresh = catchUpKeysLocked();
+    std::unordered_set<uint64_t> theirs(fresh.begin(), fresh.end());
+    std::vector<const Pending*> keep;
+    for (const auto& entry : batch) {
+        if (theirs.count(entry.key)) {
+            duplicates_++;
+            duplicate_count.add();
+        } else {
+            keep.push_back(&entry);
+        }
+    }
+    if (keep.empty()) {
+        return;
+    }
+
+    // Only ever append to the newest segment; start another once it is full
+    std::vector<Segment> segments = listSegments();
+    Segment active = segments.empty() ? segmentAt(0) : segments.back();
+    if (!segments.empty()) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(active.log, ec);
+        if (!ec && size >= kSegmentBytes) {
+            active = segmentAt(active.base + indexedRecords(active));
+        }
+    }
+    appendToSegment(active, keep);
+}
+
+void FindingsStore::appendToSegment(const Segment& segment, const std::vector<const Pending*>& batch) {
+    int log_fd = ::open(segment.log.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    int idx_fd = ::open(segment.idx.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    auto fail = [&](const std::string& what, const std::string& path) {
+        spdlog::error("Failed to {} {}: {} ({} findings lost)", what, path, std::strerror(errno), batch.size());
+        if (log_fd >= 0) ::close(log_fd);
+        if (idx_fd >= 0) ::close(idx_fd);
+    };
+    if (log_fd < 0 || idx_fd < 0) {
+        fail("open", log_fd < 0 ? segment.log : segment.idx);
+        return;
+    }
+
+    // A writer that died mid-batch leaves bytes past the last indexed record
+    // (and possibly part of an index entry); cut them off before appending
+    uint64_t records = fileSize(idx_fd) / sizeof(uint64_t);
+    uint64_t end = sizeof(kMagic);
+    if (records == 0) {
+        if (!writeAt(log_fd, kMagic, sizeof(kMagic), 0)) {
+            fail("write", segment.log);
+            return;
+        }
+    } else {
+        uint64_t last = 0;
+        uint32_t length = 0;
+        if (!readAt(idx_fd, reinterpret_cast<char*>(&last), sizeof(last), (records - 1) * sizeof(uint64_t)) ||
+            !readAt(log_fd, reinterpret_cast<char*>(&length), sizeof(length), last)) {
+            fail("read", segment.log);
+            return;
+        }
+        end = last + kHeaderSize + length;
+    }
+    if (::ftruncate(log_fd, static_cast<off_t>(end)) != 0 ||
+        ::ftruncate(idx_fd, static_cast<off_t>(records * sizeof(uint64_t))) != 0) {
+        fail("truncate", segment.log);
+        return;
+    }
+
+    std::string log;
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> keys;
+    offsets.reserve(batch.size());
+    keys.reserve(batch.size());
+    for (const Pending* entry : batch) {
+        offsets.push_back(end + log.size());
+        keys.push_back(entry->key);
+        uint32_t header[2] = {static_cast<uint32_t>(entry->json.size()),
+                              checksum(entry->json.data(), entry->json.size())};
+        log.append(reinterpret_cast<const char*>(header), sizeof(header));
+        log += entry->json;
+    }
+
+    // Records, then their index entries, then their keys: whatever a reader
+    // can find through the index is complete
+    if (!writeAt(log_fd, log.data(), log.size(), end)) {
+        fail("write", segment.log);
+        return;
+    }
+    if (config_.fsync != FsyncPolicy::NEVER && ::fsync(log_fd) != 0) {
+        spdlog::error("Failed to fsync {}: {}", segment.log, std::strerror(errno));
+    }
+    if (!writeAt(idx_fd, reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t),
+                 records * sizeof(uint64_t))) {
+        fail("write", segment.idx);
+        return;
+    }
+    if (config_.fsync != FsyncPolicy::NEVER && ::fsync(idx_fd) != 0) {
+        spdlog::error("Failed to fsync {}: {}", segment.idx, std::strerror(errno));
+    }
+    ::close(log_fd);
+    ::close(idx_fd);
+
+    uint64_t keys_size = fileSize(keys_fd_);
+    keys_size -= keys_size % sizeof(uint64_t);
+    if (::ftruncate(keys_fd_, static_cast<off_t>(keys_size)) != 0 ||
+        !writeAt(keys_fd_, reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t), keys_size)) {
+        spdlog::error("Failed to record finding keys in {}: {}", dir_, std::strerror(errno));
+        return;
+    }
+    if (config_.fsync != FsyncPolicy::NEVER && ::fsync(keys_fd_) != 0) {
+        spdlog::error("Failed to fsync keys of {}: {}", dir_, std::strerror(errno));
+    }
+    if (keys_read_ == keys_size) {
+        keys_read_ += keys.size() * sizeof(uint64_t);
+    }
+}
+
+std::vector<uint64_t> FindingsStore::catchUpKeysLocked() {
+    // A trailing partial key is a write still in progress (or one that died); skip it for now
+    uint64_t size = fileSize(keys_fd_);
+    size -= size % sizeof(uint64_t);
+
+    std::vector<uint64_t> fresh;
+    if (size <= keys_read_) {
+        return fresh;
+    }
+
+    fresh.resize((size - keys_read_) / sizeof(uint64_t));
+    if (!readAt(keys_fd_, reinterpret_cast<char*>(fresh.data()), fresh.size() * sizeof(uint64_t), keys_read_)) {
+        spdlog::warn("Failed to read finding keys of {}: {}", dir_, std::strerror(errno));
+        fresh.clear();
+        return fresh;
+    }
+    seen_.insert(fresh.begin(), fresh.end());
+    keys_read_ = size;
+    return fresh;
+}
+
+FindingsStore::Segment FindingsStore::segmentAt(uint64_t base) const {
+    return {base, segmentName(dir_, base, ".log"), segmentName(dir_, base, ".idx")};
+}
+
+std::vector<FindingsStore::Segment> FindingsStore::listSegments() const {
+    std::vector<Segment> segments;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir_, ec)) {
+        const fs::path& path = entry.path();
+        std::string stem = path.stem().string();
+        if (path.extension() != ".log" || stem.empty() ||
+            !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        segments.push_back(segmentAt(std::stoull(stem)));
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.base < b.base; });
+    return segments;
+}
+
+uint64_t FindingsStore::indexedRecords(const Segment& segment) {
+    std::error_code ec;
+    uint64_t size = fs::file_size(segment.idx, ec);
+    return ec ? 0 : size / sizeof(uint64_t);
+}
+
+std::vector<StoredFinding> FindingsStore::read(uint64_t from, size_t max) const {
+    std::vector<StoredFinding> result;
+    std::vector<Segment> segments = listSegments();
+
+    for (size_t i = 0; i < segments.size() && result.size() < max; i++) {
+        const Segment& segment = segments[i];
+        if (i + 1 < segments.size() && segments[i + 1].base <= from) {
+            continue;
+        }
+
+        // Compaction may delete a segment between listing and opening; its findings were consumed
+        int log_fd = ::open(segment.log.c_str(), O_RDONLY | O_CLOEXEC);
+        int idx_fd = ::open(segment.idx.c_str(), O_RDONLY | O_CLOEXEC);
+        if (log_fd < 0 || idx_fd < 0) {
+            if (log_fd >= 0) ::close(log_fd);
+            if (idx_fd >= 0) ::close(idx_fd);
+            continue;
+        }
+
+        uint64_t records = fileSize(idx_fd) / sizeof(uint64_t);
+        uint64_t log_size = fileSize(log_fd);
+        uint64_t first = from > segment.base ? from - segment.base : 0;
+        if (first < records) {
+            uint64_t count = std::min<uint64_t>(records - first, max - result.size());
+            std::vector<uint64_t> offsets(count);
+            if (!readAt(idx_fd, reinterpret_cast<char*>(offsets.data()), count * sizeof(uint64_t),
+                        first * sizeof(uint64_t))) {
+                offsets.clear();
+            }
+
+            for (uint64_t k = 0; k < offsets.size(); k++) {
+                uint64_t sequence = segment.base + first + k;
+                uint32_t header[2];
+                StoredFinding stored{sequence, {}};
+                bool valid = readAt(log_fd, reinterpret_cast<char*>(header), sizeof(header), offsets[k]) &&
+                             header[0] <= kMaxRecordSize &&
+                             offsets[k] + kHeaderSize + header[0] <= log_size;
+                if (valid) {
+                    stored.json.resize(header[0]);
+                    valid = readAt(log_fd, stored.json.data(), header[0], offsets[k] + kHeaderSize) &&
+                            checksum(stored.json.data(), stored.json.size()) == header[1];
+                }
+                if (!valid) {
+                    spdlog::warn("Skipping corrupt finding {} in {}", sequence, segment.log);
+                    continue;
+                }
+                result.push_back(std::move(stored));
+            }
+        }
+
+        ::close(log_fd);
+        ::close(idx_fd);
+    }
+
+    return result;
+}
+
+uint64_t FindingsStore::endSequence() const {
+    std::vector<Segment> segments = listSegments();
+    return segments.empty() ? 0 : segments.back().base + indexedRecords(segments.back());
+}
+
+uint64_t FindingsStore::cursor() const {
+    std::ifstream file((fs::path(dir_) / "cursor").string());
+    uint64_t next = 0;
+    if (!(file >> next)) {
+        return 0;
+    }
+    return next;
+}
+
+void FindingsStore::acknowledge(uint64_t next) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock file_lock(lock_fd_);
+
+    next = std::min(next, endSequence());
+    if (next <= cursor()) {
+        return;
+    }
+
+    // Replaced in one rename, so a crash never leaves a torn cursor
+    std::string path = (fs::path(dir_) / "cursor").string();
+    if (!writeFileAtomically(path, [next](std::ostream& file) { file << next << "\n"; })) {
+        spdlog::warn("Failed to write findings cursor: {}", path);
+    }
+}
+
+size_t FindingsStore::compact() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock file_lock(lock_fd_);
+
+    uint64_t next = cursor();
+    std::vector<Segment> segments = listSegments();
+
+    // A segment is done once the next one starts at or before the cursor
+    size_t removed = 0;
+    for (size_t i = 0; i + 1 < segments.size() && segments[i + 1].base <= next; i++) {
+        std::error_code ec;
+        fs::remove(segments[i].idx, ec);
+        fs::remove(segments[i].log, ec);
+        if (ec) {
+            spdlog::warn("Failed to delete {}: {}", segments[i].log, ec.message());
+            break;
+        }
+        removed++;
+    }
+
+    if (removed > 0) {
+        spdlog::info("Compacted findings store {}: deleted {} consumed segments", dir_, removed);
+    }
+    return removed;
+}
+
+size_t FindingsStore::segments() const {
+    return listSegments().size();
+}
+
+} // namespace overwatch
@@ -0,0 +1,228 @@
+#include "findings_writer.h"
+#include "metrics.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace overwatch {
+
+FindingsWriter::FindingsWriter(const std::string& path, const FindingsWriterConfig& config)
+    : path_(path), config_(config) {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open output file: " + path_ + " (" + std::strerror(errno) + ")");
+    }
+
+    buffer_.reserve(config_.buffer_bytes + 1024);
+
+    flusher_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            wake_.wait_for(lock, std::chrono::milliseconds(std::max(1, config_.flush_interval_ms)));
+            if (!buffer_.empty()) {
+                flushLocked();
+            }
+        }
+    });
+}
+
+FindingsWriter::~FindingsWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    flusher_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+    if (!buffer_.empty()) {
+        spdlog::error("{} findings could not be written to {} and are lost",
+                      std::count(buffer_.begin(), buffer_.end(), '\n'), path_);
+    }
+    ::close(fd_);
+}
+
+bool FindingsWriter::write(const Finding& finding) {
+    static Histogram& write_time = MetricsRegistry::global().histogram(
+        "overwatch_finding_write_seconds", {}, "Time to append one finding, flushes included");
+    ScopedTimer timer(write_time);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Serialize straight into the batch
+    appendJson(buffer_, finding, timestampLocked());
+    buffer_ += '\n';
+    count_++;
+
+    if (config_.fsync == FsyncPolicy::ALWAYS || buffer_.size() >= config_.buffer_bytes) {
+        flushLocked();
+    }
+    return true;
+}
+
+void FindingsWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushLocked();
+}
+
+size_t FindingsWriter::written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+void FindingsWriter::flushLocked() {
+    static Histogram& flush_time = MetricsRegistry::global().histogram(
+        "overwatch_findings_flush_seconds", {}, "Time to write (and sync) one batch of findings");
+    ScopedTimer timer(flush_time);
+
+    if (buffer_.empty()) {
+        return;
+    }
+
+    size_t offset = 0;
+    int error = 0;
+    while (offset < buffer_.size()) {
+        ssize_t n = ::write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = errno;
+            break;
+        }
+        offset += static_cast<size_t>(n);
+    }
+
+    // Whatever didn't make it stays queued and the next flush continues from
+    // the exact byte it stopped at, so a half-written record gets completed
+    if (offset < buffer_.size()) {
+        buffer_.erase(0, offset);
+        size_t pending = static_cast<size_t>(std::count(buffer_.begin(), buffer_.end(), '\n'));
+        spdlog::error("Failed to write findings to {}: {} ({} findings kept for the next flush)",
+                      path_, std::strerror(error), pending);
+        return;
+    }
+    buffer_.clear();
+
+    // Only a complete batch is synced; until then nothing is reported durable
+    if (config_.fsync != FsyncPolicy::NEVER && ::fsync(fd_) != 0) {
+        spdlog::error("Failed to fsync {}: {}", path_, std::strerror(errno));
+    }
+}
+
+const char* FindingsWriter::timestampLocked() {
+    std::time_t now = std::time(nullptr);
+    if (now != stamp_second_) {
+        std::tm utc;
+        gmtime_r(&now, &utc);
+        std::strftime(stamp_, sizeof(stamp_), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        stamp_second_ = now;
+    }
+    return stamp_;
+}
+
+FsyncPolicy FindingsWriter::parseFsyncPolicy(const std::string& name) {
+    if (name == "never") return FsyncPolicy::NEVER;
+    if (name == "flush") return FsyncPolicy::FLUSH;
+    if (name == "always") return FsyncPolicy::ALWAYS;
+    throw std::runtime_error("Unknown fsync policy: " + name + " (expected never, flush or always)");
+}
+
+void FindingsWriter::appendJson(std::string& out, const Finding& finding, const char* timestamp) {
+    // Same fields the JSONL has always had
+    out += "{\"owner\":\"";
+    appendJsonEscaped(out, finding.owner);
+    out += "\",\"repo\":\"";
+    appendJsonEscaped(out, finding.repo);
+    out += "\",\"file\":\"";
+    appendJsonEscaped(out, finding.file);
+    out += "\",\"line\":";
+    out += std::to_string(finding.match.line_number);
+    out += ",\"secret_type\":\"";
+    appendJsonEscaped(out, finding.secret_type);
+    out += "\",\"matched_text\":\"";
+    appendJsonEscaped(out, finding.match.matched_text);
+
+    char entropy[32];
+    std::snprintf(entropy, sizeof(entropy), "\",\"entropy\":%.2f", static_cast<double>(finding.match.entropy));
+    out += entropy;
+    if (finding.match.low_entropy) {
+        out += ",\"low_entropy\":true";
+    }
+
+    out += ",\"timestamp\":\"";
+    out += timestamp;
+    out += "\"}";
+}
+
+void FindingsWriter::appendJsonEscaped(std::string& out, std::string_view text) {
+    static const char kHex[] = "0123456789abcdef";
+
+    size_t i = 0;
+    while (i < text.size()) {
+        auto c = static_cast<unsigned char>(text[i]);
+
+        if (c < 0x80) {
+            switch (c) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default:
+                    if (c < 0x20) {
+                        out += "\\u00";
+                        out += kHex[c >> 4];
+                        out += kHex[c & 0xF];
+                    } else {
+                        out += static_cast<char>(c);
+                    }
+            }
+            i++;
+            continue;
+        }
+
+        // Multi-byte UTF-8: copy well-formed sequences, replace anything else
+        size_t length = 0;
+        unsigned min_second = 0x80;
+        unsigned max_second = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            length = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            length = 3;
+            if (c == 0xE0) min_second = 0xA0;   // Overlong
+            if (c == 0xED) max_second = 0x9F;   // Surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            length = 4;
+            if (c == 0xF0) min_second = 0x90;   // Overlong
+            if (c == 0xF4) max_second = 0x8F;   // Above U+10FFFF
+        }
+
+        bool valid = length > 0 && i + length <= text.size();
+        for (size_t k = 1; valid && k < length; k++) {
+            auto next = static_cast<unsigned char>(text[i + k]);
+            unsigned low = k == 1 ? min_second : 0x80;
+            unsigned high = k == 1 ? max_second : 0xBF;
+            valid = next >= low && next <= high;
+        }
+
+        if (valid) {
+            out.append(text.data() + i, length);
+            i += length;
+        } else {
+            out += "\xEF\xBF\xBD";
+            i++;
+        }
+    }
+}
+
+} // namespace overwatch
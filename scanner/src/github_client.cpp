@@ -1,211 +1,803 @@
 #include "github_client.h"
 #include "base64.h"
+#include "metrics.h"
 #include <cpr/cpr.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <thread>
+#include <type_traits>
 
 namespace overwatch {
 
 // Constructor 
 GitHubClient::GitHubClient(const std::string& token)
-    : token_(token), base_url_("https://api.github.com")
+    : GitHubClient(token.empty() ? std::vector<std::string>{} : std::vector<std::string>{token})
 {
-    if (token_.empty()) {
+}
+
+GitHubClient::GitHubClient(const std::vector<std::string>& tokens)
+    : pool_(tokens), base_url_("https://api.github.com")
+{
+    if (!pool_.authenticated()) {
         spdlog::warn("GitHubClient created without token - using unauthenticated API");
     } else {
-        spdlog::debug("GitHubClient created with token");
+        spdlog::debug("GitHubClient created with {} token(s)", pool_.size());
     }
 }
 
-// Validate Github Token
+// Validate Github Tokens, dropping any that don't work
 bool GitHubClient::validateToken() {
-    if (token_.empty()) {
+    if (!pool_.authenticated()) {
         return true;  // No token is okay (uses unauthenticated API)
     }
 
-    spdlog::debug("Validating GitHub token");
+    size_t total = pool_.size();
 
-    // Build headers
-    cpr::Header headers = {{"User-Agent", "OverWatch-Scanner"}};
-    headers["Authorization"] = "token " + token_;
+    for (size_t i = pool_.size(); i-- > 0; ) {
+        TokenState& token = pool_.at(i);
+        spdlog::debug("Validating GitHub token {}", token.label);
 
-    // Try to access user endpoint (requires authentication)
-    cpr::Response r = cpr::Get(
-        cpr::Url{base_url_ + "/user"},
-        headers
-    );
+        // Try to access user endpoint (requires authentication)
+        cpr::Response r = get(RateResource::CORE, base_url_ + "/user", {}, &token);
 
-    if (r.status_code == 401) {
-        spdlog::error("GitHub token is invalid or expired!");
-        spdlog::error("Please check your token at: https://github.com/settings/tokens");
-        return false;
-    }
+        if (r.status_code == 200) {
+            continue;
+        }
 
-    if (r.status_code == 403) {
-        spdlog::error("GitHub token lacks required permissions!");
-        spdlog::error("Token needs 'public_repo' scope");
-        return false;
+        if (r.status_code == 401) {
+            spdlog::error("GitHub token {} is invalid or expired!", token.label);
+            spdlog::error("Please check your token at: https://github.com/settings/tokens");
+        } else if (r.status_code == 403) {
+            spdlog::error("GitHub token {} lacks required permissions!", token.label);
+            spdlog::error("Token needs 'public_repo' scope");
+        } else {
+            spdlog::warn("Could not validate token {}: HTTP {}", token.label, r.status_code);
+        }
+
+        // Keep at least one slot so the error surfaces on the next request
+        if (pool_.size() > 1) {
+            {
+                std::lock_guard<std::mutex> lock(sessions_mutex_);
+                idle_sessions_.erase(&token);
+            }
+            pool_.remove(i);
+        } else {
+            return false;
+        }
     }
 
-    if (r.status_code != 200) {
-        spdlog::warn("Could not validate token: HTTP {}", r.status_code);
-        return false;
+    if (pool_.size() < total) {
+        spdlog::warn("Continuing with {}/{} valid tokens", pool_.size(), total);
     }
 
-    spdlog::debug("Token is valid");
+    spdlog::debug("Token(s) valid");
     return true;
 }
 
-// getRateLimit
+// getRateLimit (summed over every token in the pool)
 nlohmann::json GitHubClient::getRateLimit() {
     spdlog::info("Fetching rate limit from GitHub API");
 
-    // Build headers
-    cpr::Header headers = {{"User-Agent", "OverWatch-Scanner"}};
-    if (!token_.empty()) {
-        headers["Authorization"] = "token " + token_;
+    nlohmann::json combined;
+
+    for (size_t i = 0; i < pool_.size(); i++) {
+        TokenState& token = pool_.at(i);
+
+        // Make request (/rate_limit does not count against the quota)
+        cpr::Response r = perform(token, base_url_ + "/rate_limit");
+
+        // Check status
+        if (r.status_code != 200) {
+            spdlog::error("GitHub API returned status {}", r.status_code);
+            throw std::runtime_error("Failed to get rate limit");
+        }
+
+        // Parse JSON and seed this token's scheduler with its current quota
+        nlohmann::json data = nlohmann::json::parse(r.text);
+
+        if (data.contains("resources")) {
+            for (const auto& [name, bucket] : data["resources"].items()) {
+                RateResource resource;
+                if (RateLimiter::parseResource(name, resource)) {
+                    RateLimitInfo info;
+                    info.limit = bucket.value("limit", -1);
+                    info.remaining = bucket.value("remaining", -1);
+                    info.reset = bucket.value("reset", 0LL);
+                    token.limiter.update(resource, info);
+                }
+            }
+        }
+
+        if (pool_.size() > 1) {
+            spdlog::debug("Token {}: {}/{} core requests remaining", token.label,
+                        data["rate"].value("remaining", 0), data["rate"].value("limit", 0));
+        }
+
+        // Add this token's limits to the pool totals
+        if (i == 0) {
+            combined = data;
+            continue;
+        }
+
+        for (const char* field : {"limit", "remaining"}) {
+            combined["rate"][field] = combined["rate"].value(field, 0) + data["rate"].value(field, 0);
+            for (auto& [name, bucket] : combined["resources"].items()) {
+                if (data["resources"].contains(name)) {
+                    bucket[field] = bucket.value(field, 0) + data["resources"][name].value(field, 0);
+                }
+            }
+        }
     }
 
-    // Make request
-    cpr::Response r = cpr::Get(
-        cpr::Url{base_url_ + "/rate_limit"},
-        headers
-    );
+    return combined;
+}
 
-    // Check status
-    if (r.status_code != 200) {
-        spdlog::error("GitHub API returned status {}", r.status_code);
-        throw std::runtime_error("Failed to get rate limit");
+// Request latency by endpoint and status code, so 404 probes show apart from downloads
+void GitHubClient::recordRequest(const std::string& url, long status, uint64_t nanos) {
+    // Failed transfers and 304s cost no quota
+    if (status != 0 && status != 304) {
+        requests_sent_++;
+    }
+
+    const char* endpoint = "other";
+    if (url.find("/search/") != std::string::npos) {
+        endpoint = "search";
+    } else if (url.find("/contents/") != std::string::npos) {
+        endpoint = "contents";
+    } else if (url.find("/git/trees/") != std::string::npos) {
+        endpoint = "tree";
+    } else if (url.find("/tarball/") != std::string::npos) {
+        endpoint = "tarball";
+    } else if (url.find("/graphql") != std::string::npos) {
+        endpoint = "graphql";
+    }
+
+    MetricsRegistry::global().histogram("overwatch_github_request_seconds",
+                                        {{"endpoint", endpoint}, {"status", std::to_string(status)}},
+                                        "GitHub API request latency (status 0: transfer failed)").record(nanos);
+}
+
+// Build a Repository from one search result item
+static Repository parseRepository(const nlohmann::json& item) {
+    auto text = [&item](const char* key) {
+        auto it = item.find(key);
+        return it != item.end() && it->is_string() ? it->get<std::string>() : std::string();
+    };
+
+    Repository repo;
+    repo.owner = item["owner"]["login"];
+    repo.name = item["name"];
+    repo.url = item["html_url"];
+    repo.stars = item["stargazers_count"];
+    repo.language = text("language");
+    repo.archived = item.contains("archived") && !item["archived"].is_null() ? item["archived"].get<bool>() : false;
+    repo.default_branch = text("default_branch");
+    repo.pushed_at = text("pushed_at");
+    repo.created_at = text("created_at");
+    return repo;
+}
+
+// Search parameters plus the optional sort order
+static cpr::Parameters searchParameters(const std::string& query, int per_page, int page,
+                                        const SearchOptions& options) {
+    cpr::Parameters parameters{{"q", query}, {"per_page", std::to_string(per_page)}};
+    if (page > 0) {
+        parameters.Add({"page", std::to_string(page)});
+    }
+    if (!options.sort.empty()) {
+        parameters.Add({"sort", options.sort});
     }
+    if (!options.order.empty()) {
+        parameters.Add({"order", options.order});
+    }
+    return parameters;
+}
 
-    // Parse and return JSON
-    return nlohmann::json::parse(r.text);
+// Cache key naming the same request as searchParameters
+static std::string searchCacheKey(const std::string& url, const std::string& query, int per_page, int page,
+                                  const SearchOptions& options) {
+    std::string key = url + "?q=" + query + "&per_page=" + std::to_string(per_page);
+    if (page > 0) {
+        key += "&page=" + std::to_string(page);
+    }
+    if (!options.sort.empty()) {
+        key += "&sort=" + options.sort;
+    }
+    if (!options.order.empty()) {
+        key += "&order=" + options.order;
+    }
+    return key;
 }
 
 // Search Repos with Given Filters
-std::vector<Repository> GitHubClient::searchRepositories(const std::string& query, int max_results) {
+std::vector<Repository> GitHubClient::searchRepositories(const std::string& query, int max_results,
+                                                         const SearchOptions& options) {
+    std::vector<Repository> repositories;
+
+    searchRepositoriesPaged(query, max_results, options, [&repositories](SearchPage& page) {
+        std::move(page.repositories.begin(), page.repositories.end(), std::back_inserter(repositories));
+        return true;
+    });
+
+    return repositories;
+}
+
+int GitHubClient::searchRepositoriesPaged(const std::string& query, int max_results, const SearchOptions& options,
+                                          const std::function<bool(SearchPage&)>& on_page) {
     spdlog::info("Searching repositories with query: {}", query);
 
-    std::vector<Repository> repositories;
+    // Handle unlimited mode (max_results = 0)
+    if (max_results <= 0) {
+        spdlog::info("Unlimited mode - fetching all available repositories");
+    }
 
-    // Build headers
-    cpr::Header headers = {{"User-Agent", "OverWatch-Scanner"}};
-    if (!token_.empty()) {
-        headers["Authorization"] = "token " + token_;
+    int limit = max_results <= 0 ? kMaxSearchResults : std::min(max_results, kMaxSearchResults);
+    std::optional<SearchPage> first = fetchSearchPage(query, std::min(limit, kMaxSearchPerPage), 1, options);
+    if (first && first->total_count >= 0) {
+        spdlog::info("Query matches {} total repositories", first->total_count);
     }
 
-    // Handle unlimited mode (max_results = 0)
-    if (max_results == 0) {
-        spdlog::info("Unlimited mode - fetching all available repositories (up to 1000)");
+    // Past 1000 matches, only splitting the query reaches the rest
+    bool wants_more = max_results <= 0 || max_results > kMaxSearchResults;
+    if (first && first->total_count > kMaxSearchResults && wants_more) {
+        if (options.shard_workers > 0 && query.find("created:") == std::string::npos) {
+            return searchSharded(query, max_results, options, on_page);
+        }
+        spdlog::warn("Query matches more than {} repositories; only the first {} are reachable",
+                     kMaxSearchResults, kMaxSearchResults);
+    }
+
+    int delivered = streamSearch(query, limit, options, std::move(first), on_page);
+    spdlog::info("Found {} repositories", delivered);
+    return delivered;
+}
 
-        int page = 1;
-        int per_page = 100;  // GitHub API max per page
-        int total_fetched = 0;
+int GitHubClient::streamSearch(const std::string& query, int limit, const SearchOptions& options,
+                               std::optional<SearchPage> first, const std::function<bool(SearchPage&)>& on_page) {
+    int per_page = std::min(limit, kMaxSearchPerPage);
+    int delivered = 0;
 
-        while (true) {
-            // Make paginated request
-            cpr::Response r = cpr::Get(
-                cpr::Url{base_url_ + "/search/repositories"},
-                cpr::Parameters{{"q", query}, {"per_page", std::to_string(per_page)}, {"page", std::to_string(page)}},
-                headers
-            );
-
-            // Check status
-            if (r.status_code != 200) {
-                spdlog::warn("Search failed with status {} on page {}", r.status_code, page);
-                break;
+    auto fetch = [this, &query, &options, per_page](int page) {
+        return fetchSearchPage(query, per_page, page, options);
+    };
+
+    // Always one page ahead: page N+1 downloads while the caller works through page N
+    std::optional<SearchPage> current = std::move(first);
+    std::future<std::optional<SearchPage>> next;
+
+    for (int page = 1; ; page++) {
+        if (page > 1) {
+            current = next.get();
+        }
+        if (!current || current->repositories.empty()) {
+            break;  // Failed, or no more results
+        }
+
+        int room = limit - delivered;
+        if (static_cast<int>(current->repositories.size()) > room) {
+            current->repositories.resize(static_cast<size_t>(room));
+        }
+        int received = static_cast<int>(current->repositories.size());
+        delivered += received;
+
+        // GitHub serves at most 1000 results per query; a short page is the last one
+        bool more = delivered < limit && received == per_page &&
+                    (current->total_count < 0 || delivered < current->total_count) &&
+                    page * per_page < kMaxSearchResults;
+        if (more) {
+            next = std::async(std::launch::async, fetch, page + 1);
+        } else if (delivered >= kMaxSearchResults) {
+            spdlog::info("Reached GitHub's {} result limit", kMaxSearchResults);
+        }
+
+        spdlog::debug("Fetched page {} - {} repositories so far", page, delivered);
+
+        if (!on_page(*current) || !more) {
+            break;
+        }
+    }
+
+    return delivered;
+}
+
+int GitHubClient::searchSharded(const std::string& query, int max_results, const SearchOptions& options,
+                                const std::function<bool(SearchPage&)>& on_page) {
+    // Search windows over the creation time, in whole seconds since the epoch
+    struct Window {
+        int64_t from;
+        int64_t to;  // Inclusive
+        int attempts = 0;  // Failed fetches of its first page so far
+    };
+
+    auto format_time = [](int64_t seconds) {
+        std::time_t t = static_cast<std::time_t>(seconds);
+        std::tm tm{};
+        gmtime_r(&t, &tm);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        return std::string(buffer);
+    };
+
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Window> pending{{kFirstRepositoryCreated, now}};
+    int active = 0;               // Windows currently being worked on
+    int delivered = 0;
+    int shards = 0;
+    int failed_shards = 0;
+    bool stopped = false;
+
+    // Pages of all shards go out one at a time, so on_page needs no locking of its own
+    std::mutex deliver_mutex;
+    auto deliver = [&](SearchPage& page) {
+        std::lock_guard<std::mutex> lock(deliver_mutex);
+        {
+            std::lock_guard<std::mutex> state_lock(mutex);
+            if (stopped) {
+                return false;
+            }
+            if (max_results > 0) {
+                int room = max_results - delivered;
+                if (static_cast<int>(page.repositories.size()) > room) {
+                    page.repositories.resize(static_cast<size_t>(room));
+                }
             }
+            delivered += static_cast<int>(page.repositories.size());
+        }
+
+        bool keep_going = on_page(page);
 
-            // Parse JSON response
-            nlohmann::json response = nlohmann::json::parse(r.text);
+        std::lock_guard<std::mutex> state_lock(mutex);
+        if (!keep_going || (max_results > 0 && delivered >= max_results)) {
+            stopped = true;
+            cv.notify_all();
+        }
+        return !stopped;
+    };
 
-            // Extract total count (for info)
-            if (page == 1 && response.contains("total_count")) {
-                int total = response["total_count"];
-                spdlog::info("Query matches {} total repositories", total);
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] { return stopped || !pending.empty() || active == 0; });
+            if (stopped || pending.empty()) {
+                return;  // Stopped, or every window is done
             }
 
-            // Extract repositories from array
-            if (response.contains("items") && !response["items"].empty()) {
-                for (const auto& item : response["items"]) {
-                    Repository repo;
-                    repo.owner = item["owner"]["login"];
-                    repo.name = item["name"];
-                    repo.url = item["html_url"];
-                    repo.stars = item["stargazers_count"];
-                    repo.language = item["language"].is_null() ? "" : item["language"];
-                    repo.archived = item.contains("archived") && !item["archived"].is_null() ? item["archived"].get<bool>() : false;
+            Window window = pending.front();
+            pending.pop_front();
+            active++;
+            lock.unlock();
+
+            std::string shard_query = query + " created:" + format_time(window.from) + ".." + format_time(window.to);
+            std::optional<SearchPage> first = fetchSearchPage(shard_query, kMaxSearchPerPage, 1, options);
 
-                    repositories.push_back(repo);
-                    total_fetched++;
+            if (!first) {
+                // Requeued at the back so other windows make progress meanwhile
+                window.attempts++;
+                lock.lock();
+                if (window.attempts < kMaxShardAttempts) {
+                    spdlog::warn("Search shard {} failed, retrying ({}/{})", shard_query, window.attempts,
+                                 kMaxShardAttempts);
+                    pending.push_back(window);
+                } else {
+                    spdlog::error("Search shard {} failed {} times; its repositories are skipped this run",
+                                  shard_query, window.attempts);
+                    failed_shards++;
                 }
+                active--;
+                cv.notify_all();
+                continue;
+            }
 
-                spdlog::debug("Fetched page {} - {} repositories so far", page, total_fetched);
+            if (first && first->total_count > kMaxSearchResults && window.from < window.to) {
+                // Still too wide: halve the window and queue both sides
+                int64_t mid = window.from + (window.to - window.from) / 2;
+                lock.lock();
+                pending.push_back({window.from, mid});
+                pending.push_back({mid + 1, window.to});
+                active--;
+                cv.notify_all();
+                continue;
+            }
 
-                // GitHub limits to 1000 results max, stop if we hit it
-                if (total_fetched >= 1000) {
-                    spdlog::info("Reached GitHub's 1000 result limit");
-                    break;
-                }
+            if (first && first->total_count > kMaxSearchResults) {
+                spdlog::warn("{} repositories created at {}; only the first {} are reachable",
+                             first->total_count, format_time(window.from), kMaxSearchResults);
+            }
 
-                page++;
-            } else {
-                // No more results
-                break;
+            if (first && !first->repositories.empty()) {
+                spdlog::debug("Shard {}: {} repositories", shard_query, first->total_count);
+                streamSearch(shard_query, kMaxSearchResults, options, std::move(first), deliver);
             }
+
+            lock.lock();
+            shards++;
+            active--;
+            cv.notify_all();
         }
+    };
 
-        spdlog::info("Found {} repositories total", repositories.size());
-        return repositories;
+    spdlog::info("Splitting the query by creation date across {} search workers", options.shard_workers);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.shard_workers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread : workers) {
+        thread.join();
     }
 
-    // Limited mode - single page fetch
-    cpr::Response r = cpr::Get(
-        cpr::Url{base_url_ + "/search/repositories"},
-        cpr::Parameters{{"q", query}, {"per_page", std::to_string(max_results)}},
-        headers
+    if (failed_shards > 0) {
+        spdlog::warn("Found {} repositories across {} shards, {} shards failed", delivered, shards, failed_shards);
+    } else {
+        spdlog::info("Found {} repositories across {} shards", delivered, shards);
+    }
+    return delivered;
+}
+
+std::optional<SearchPage> GitHubClient::fetchSearchPage(const std::string& query, int per_page, int page,
+                                                         const SearchOptions& options) {
+    std::string url = base_url_ + "/search/repositories";
+    cpr::Response r = get(
+        RateResource::SEARCH,
+        url,
+        searchParameters(query, per_page, page, options),
+        nullptr,
+        searchCacheKey(url, query, per_page, page, options)
     );
 
     // Check status
     if (r.status_code != 200) {
-        spdlog::error("Search failed with status {}", r.status_code);
-        return repositories;
+        spdlog::warn("Search failed with status {} on page {}", r.status_code, page);
+        return std::nullopt;
     }
 
     // Parse JSON response
     nlohmann::json response = nlohmann::json::parse(r.text);
 
+    SearchPage result;
+    result.page = page;
+    if (response.contains("total_count") && response["total_count"].is_number()) {
+        result.total_count = response["total_count"].get<long>();
+    }
+
     // Extract repositories from array
     if (response.contains("items")) {
         for (const auto& item : response["items"]) {
-            Repository repo;
-            repo.owner = item["owner"]["login"];
-            repo.name = item["name"];
-            repo.url = item["html_url"];
-            repo.stars = item["stargazers_count"];
-            repo.language = item["language"].is_null() ? "" : item["language"];
-            repo.archived = item.contains("archived") && !item["archived"].is_null() ? item["archived"].get<bool>() : false;
+            result.repositories.push_back(parseRepository(item));
+        }
+    }
+    static Counter& found = MetricsRegistry::global().counter(
+        "overwatch_search_results_total", {}, "Repositories returned by code search");
+    found.add(result.repositories.size());
+
+    return result;
+}
+
+// Common headers for every request made with a token
+cpr::Header GitHubClient::buildHeaders(const TokenState& token) const {
+    cpr::Header headers = {{"User-Agent", "OverWatch-Scanner"}};
+    if (!token.token.empty()) {
+        headers["Authorization"] = "token " + token.token;
+    }
+    return headers;
+}
 
-            repositories.push_back(repo);
+// Take an idle session for this token, or open a new one
+std::unique_ptr<cpr::Session> GitHubClient::acquireSession(TokenState& token) {
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto& idle = idle_sessions_[&token];
+        if (!idle.empty()) {
+            std::unique_ptr<cpr::Session> session = std::move(idle.back());
+            idle.pop_back();
+            return session;
         }
     }
 
-    spdlog::info("Found {} repositories", repositories.size());
-    return repositories;
+    // Headers are set once per session; the curl handle inside keeps its
+    // connection to api.github.com alive between requests
+    auto session = std::make_unique<cpr::Session>();
+    session->SetHeader(buildHeaders(token));
+    session->SetHttpVersion(cpr::HttpVersion{cpr::HttpVersionCode::VERSION_2_0_TLS});
+    session->SetConnectTimeout(cpr::ConnectTimeout{std::chrono::seconds(10)});
+    session->SetTimeout(cpr::Timeout{std::chrono::seconds(60)});
+    return session;
 }
 
-// Get File Contents from Repo
-std::string GitHubClient::getFileContent(const std::string& owner, const std::string& repo, const std::string& path) {
-    spdlog::debug("Fetching file: {}/{}/{}", owner, repo, path);
+void GitHubClient::releaseSession(TokenState& token, std::unique_ptr<cpr::Session> session) {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    idle_sessions_[&token].push_back(std::move(session));
+}
 
-    // Build headers
-    cpr::Header headers = {{"User-Agent", "OverWatch-Scanner"}};
-    if (!token_.empty()) {
-        headers["Authorization"] = "token " + token_;
+void GitHubClient::enableHttpCache(const std::string& dir, uint64_t max_bytes) {
+    http_cache_ = std::make_unique<HttpCache>(dir, max_bytes);
+}
+
+void GitHubClient::recordFixtures(const std::string& dir) {
+    fixtures_ = std::make_unique<HttpFixtures>(dir, HttpFixtures::Mode::RECORD);
+}
+
+void GitHubClient::replayFixtures(const std::string& dir) {
+    fixtures_ = std::make_unique<HttpFixtures>(dir, HttpFixtures::Mode::REPLAY);
+}
+
+cpr::Response GitHubClient::replay(const std::string& key, const std::string& url) const {
+    cpr::Response r;
+    r.url = cpr::Url{url};
+
+    std::optional<RecordedResponse> recorded = fixtures_->load(key);
+    if (!recorded) {
+        spdlog::debug("No fixture for {}", key);
+        r.status_code = 404;
+        return r;
+    }
+
+    r.status_code = recorded->status_code;
+    for (auto& [name, value] : recorded->headers) {
+        r.header[name] = std::move(value);
+    }
+    r.text = std::move(recorded->body);
+    return r;
+}
+
+void GitHubClient::record(const std::string& key, const cpr::Response& r) const {
+    // Transfer failures say nothing about the server; leave them out of the recording
+    if (!fixtures_ || fixtures_->mode() != HttpFixtures::Mode::RECORD || r.error) {
+        return;
+    }
+
+    RecordedResponse recorded;
+    recorded.status_code = r.status_code;
+    for (const auto& [name, value] : r.header) {
+        recorded.headers.emplace_back(name, value);
+    }
+    recorded.body = r.text;
+    fixtures_->store(key, recorded);
+}
+
+void GitHubClient::acquire(TokenState& token, RateResource resource) {
+    if (!replaying()) {
+        token.limiter.acquire(resource);
+    }
+}
+
+cpr::Response GitHubClient::perform(TokenState& token, const std::string& url,
+                                    const cpr::Parameters& parameters, const std::string& cache_key) {
+    // The cache key, where there is one, already names the query parameters
+    std::string fixture_key = "GET " + (cache_key.empty() ? url : cache_key);
+    Stopwatch watch;
+    if (replaying()) {
+        cpr::Response r = replay(fixture_key, url);
+        recordRequest(url, r.status_code, watch.elapsed());
+        return r;
+    }
+
+    std::unique_ptr<cpr::Session> session = acquireSession(token);
+
+    // Validators from a cached copy turn this into a conditional request
+    std::optional<CachedResponse> cached;
+    if (http_cache_ && !cache_key.empty()) {
+        cached = http_cache_->load(cache_key);
+    }
+
+    if (cached) {
+        cpr::Header headers = buildHeaders(token);
+        if (!cached->etag.empty()) {
+            headers["If-None-Match"] = cached->etag;
+        }
+        if (!cached->last_modified.empty()) {
+            headers["If-Modified-Since"] = cached->last_modified;
+        }
+        session->SetHeader(headers);
+    }
+
+    session->SetUrl(cpr::Url{url});
+    session->SetParameters(parameters);  // Always set, so a previous request's query can't leak
+    cpr::Response r = session->Get();
+    recordRequest(url, r.error ? 0 : r.status_code, watch.elapsed());
+
+    // Pooled sessions go back with only the common headers
+    if (cached) {
+        session->SetHeader(buildHeaders(token));
+    }
+
+    // A failed transfer may leave the connection in a bad state - don't reuse it
+    if (!r.error) {
+        releaseSession(token, std::move(session));
+    }
+
+    if (cached && r.status_code == 304) {
+        spdlog::debug("Not modified, serving cached response: {}", cache_key);
+        r.status_code = 200;
+        r.text = std::move(cached->body);
+    } else if (http_cache_ && !cache_key.empty() && r.status_code == 200) {
+        CachedResponse fresh;
+        auto etag = r.header.find("ETag");
+        if (etag != r.header.end()) {
+            fresh.etag = etag->second;
+        }
+        auto modified = r.header.find("Last-Modified");
+        if (modified != r.header.end()) {
+            fresh.last_modified = modified->second;
+        }
+        if (!fresh.etag.empty() || !fresh.last_modified.empty()) {
+            fresh.body = r.text;
+            http_cache_->store(cache_key, fresh);
+        }
+    }
+
+    record(fixture_key, r);
+    return r;
+}
+
+// Parse X-RateLimit-* and Retry-After from a response
+static RateLimitInfo parseRateLimitHeaders(const cpr::Header& headers) {
+    RateLimitInfo info;
+
+    auto read = [&headers](const char* name, auto& field) {
+        auto it = headers.find(name);
+        if (it != headers.end() && !it->second.empty()) {
+            try {
+                field = static_cast<std::decay_t<decltype(field)>>(std::stoll(it->second));
+            } catch (const std::exception&) {
+                // Malformed header - keep the default
+            }
+        }
+    };
+
+    read("X-RateLimit-Limit", info.limit);
+    read("X-RateLimit-Remaining", info.remaining);
+    read("X-RateLimit-Reset", info.reset);
+    read("Retry-After", info.retry_after);
+    return info;
+}
+
+bool GitHubClient::handleRateLimit(TokenState& token, RateResource resource,
+                                   const cpr::Response& r, int attempt) {
+    // Recorded quota headers describe the recording run, not this one
+    if (replaying()) {
+        return false;
+    }
+
+    RateLimitInfo info = parseRateLimitHeaders(r.header);
+
+    // Responses name their bucket; trust that over the caller's guess
+    auto it = r.header.find("X-RateLimit-Resource");
+    if (it != r.header.end()) {
+        RateLimiter::parseResource(it->second, resource);
+    }
+
+    token.limiter.update(resource, info);
+
+    if (r.status_code != 403 && r.status_code != 429) {
+        return false;
+    }
+
+    // 403 is also used for permission errors; only treat it as a rate limit when it says so
+    bool rate_limited = r.status_code == 429 || info.retry_after > 0 || info.remaining == 0 ||
+                        r.text.find("rate limit") != std::string::npos;
+    if (!rate_limited) {
+        return false;
+    }
+
+    // Secondary limits without Retry-After: wait a minute, doubling on each retry
+    if (info.retry_after <= 0 && info.remaining != 0) {
+        auto delay = std::chrono::seconds(60LL << std::min(attempt, 4));
+        spdlog::warn("Secondary rate limit hit on token {} (HTTP {}), backing off for {}s",
+                     token.label, r.status_code, delay.count());
+        token.limiter.backoff(resource, delay);
+    } else {
+        spdlog::warn("Token {} rate limited (HTTP {}), moving to the next available token",
+                     token.label, r.status_code);
+    }
+
+    return true;
+}
+
+cpr::Response GitHubClient::get(RateResource resource, const std::string& url,
+                                const cpr::Parameters& parameters, TokenState* fixed_token,
+                                const std::string& cache_key) {
+    for (int attempt = 0; ; attempt++) {
+        // Re-pick each attempt so a rate limited token hands over to a fresher one
+        TokenState& token = fixed_token ? *fixed_token : pool_.select(resource);
+
+        acquire(token, resource);
+        cpr::Response r = perform(token, url, parameters, cache_key);
+
+        if (!handleRateLimit(token, resource, r, attempt) || attempt >= kMaxRateLimitRetries) {
+            return r;
+        }
+    }
+}
+
+// Percent-encode a repository path for use in a URL (keeps '/' separators)
+static std::string encodePath(const std::string& path) {
+    static const char* hex = "0123456789ABCDEF";
+    std::string encoded;
+    encoded.reserve(path.size());
+
+    for (unsigned char c : path) {
+        if (std::isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+            encoded += static_cast<char>(c);
+        } else {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 0x0F];
+        }
+    }
+
+    return encoded;
+}
+
+// Picks "content" and "sha" out of a Contents API response as it is parsed,
+// without building a document; the strings are moved out of the parser
+class ContentFields : public nlohmann::json_sax<nlohmann::json> {
+public:
+    std::string content;
+    std::string sha;
+    bool has_content = false;
+
+    bool null() override { return value(); }
+    bool boolean(bool) override { return value(); }
+    bool number_integer(number_integer_t) override { return value(); }
+    bool number_unsigned(number_unsigned_t) override { return value(); }
+    bool number_float(number_float_t, const string_t&) override { return value(); }
+    bool binary(binary_t&) override { return value(); }
+
+    bool string(string_t& val) override {
+        if (target_ == &content) {
+            has_content = true;
+        }
+        if (target_) {
+            *target_ = std::move(val);
+        }
+        return value();
+    }
+
+    bool key(string_t& val) override {
+        if (depth_ == 1 && val == "content") {
+            target_ = &content;
+        } else if (depth_ == 1 && val == "sha") {
+            target_ = &sha;
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override { depth_++; return value(); }
+    bool end_object() override { depth_--; return true; }
+    bool start_array(std::size_t) override { depth_++; return value(); }
+    bool end_array() override { depth_--; return true; }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        error = e.what();
+        return false;
     }
 
-    std::string url = base_url_ + "/repos/" + owner + "/" + repo + "/contents/" + path;
-    cpr::Response r = cpr::Get(cpr::Url{url}, headers);
+    std::string error;
+
+private:
+    int depth_ = 0;
+    std::string* target_ = nullptr;   // Where the value of the current top-level key goes, if wanted
+
+    bool value() {
+        target_ = nullptr;
+        return true;
+    }
+};
 
+// Decode a Contents API response into the raw file text and its blob SHA
+static FileContent decodeContentResponse(const cpr::Response& r, const std::string& path) {
     // Check status
     if (r.status_code != 200) {
         if (r.status_code == 404) {
@@ -216,19 +808,389 @@ std::string GitHubClient::getFileContent(const std::string& owner, const std::st
         throw std::runtime_error("Failed to fetch file: " + path);
     }
 
-    // Parse JSON response
-    nlohmann::json response = nlohmann::json::parse(r.text);
+    // Parse JSON response; only two fields are needed, so no document is built
+    ContentFields response;
+    if (!nlohmann::json::sax_parse(r.text, &response)) {
+        throw std::runtime_error("Invalid contents response for " + path + ": " + response.error);
+    }
 
     // Extract and decode base64 content
-    if (!response.contains("content")) {
+    if (!response.has_content) {
         throw std::runtime_error("No content field in API response");
     }
 
-    std::string base64_content = response["content"];
-    std::string decoded = base64_decode(base64_content, true);  // true = remove linebreaks
+    static Histogram& decode_time = MetricsRegistry::global().histogram(
+        "overwatch_base64_decode_seconds", {}, "Time to decode one file from the contents API");
+    static Counter& decoded_bytes = MetricsRegistry::global().counter(
+        "overwatch_base64_decoded_bytes_total", {}, "Bytes of file content decoded from base64");
+
+    FileContent file;
+    {
+        ScopedTimer timer(decode_time);
+        file.content = base64_decode(response.content, true);  // true = remove linebreaks
+    }
+    decoded_bytes.add(file.content.size());
+    file.sha = std::move(response.sha);
+
+    spdlog::debug("Successfully fetched {} bytes", file.content.size());
+    return file;
+}
+
+// Get File Contents from Repo
+std::string GitHubClient::getFileContent(const std::string& owner, const std::string& repo, const std::string& path) {
+    spdlog::debug("Fetching file: {}/{}/{}", owner, repo, path);
+
+    std::string url = base_url_ + "/repos/" + owner + "/" + repo + "/contents/" + encodePath(path);
+    cpr::Response r = get(RateResource::CORE, url, {}, nullptr, url);
+
+    return decodeContentResponse(r, path).content;
+}
+
+// Get Several File Contents from Repo, keeping up to max_in_flight requests open
+std::vector<std::optional<FileContent>> GitHubClient::getFileContents(const std::string& owner, const std::string& repo,
+                                                                      const std::vector<std::string>& paths,
+                                                                      int max_in_flight) {
+    std::vector<std::optional<FileContent>> results(paths.size());
+    size_t window = static_cast<size_t>(std::max(1, max_in_flight));
+
+    std::string repo_url = base_url_ + "/repos/" + owner + "/" + repo + "/contents/";
+
+    // Sliding window of async requests, each on a pooled session; always wait
+    // on the oldest so results complete in the same order as paths
+    struct Pending {
+        size_t index;
+        TokenState* token;
+        std::future<cpr::Response> response;
+    };
+    std::deque<Pending> in_flight;
+    size_t next = 0;
+
+    while (next < paths.size() || !in_flight.empty()) {
+        while (next < paths.size() && in_flight.size() < window) {
+            spdlog::debug("Fetching file: {}/{}/{}", owner, repo, paths[next]);
+            TokenState& token = pool_.select(RateResource::CORE);
+            acquire(token, RateResource::CORE);
+            std::string url = repo_url + encodePath(paths[next]);
+            in_flight.push_back({next, &token, std::async(std::launch::async, [this, &token, url]() {
+                return perform(token, url, {}, url);
+            })});
+            next++;
+        }
+
+        size_t index = in_flight.front().index;
+        TokenState& token = *in_flight.front().token;
+        cpr::Response r = in_flight.front().response.get();
+        in_flight.pop_front();
+
+        // Rate limited: retry this one synchronously once the scheduler allows it
+        if (handleRateLimit(token, RateResource::CORE, r, 0)) {
+            std::string url = repo_url + encodePath(paths[index]);
+            r = get(RateResource::CORE, url, {}, nullptr, url);
+        }
+
+        try {
+            results[index] = decodeContentResponse(r, paths[index]);
+        } catch (const std::exception& e) {
+            // File doesn't exist or couldn't be decoded - leave as nullopt
+            spdlog::debug("Could not fetch {}: {}", paths[index], e.what());
+        }
+    }
+
+    return results;
+}
+
+// Get Files from Many Repos in a few GraphQL queries, falling back to the contents API
+std::vector<std::optional<FileContent>> GitHubClient::batchGetFiles(const std::vector<FileRequest>& requests,
+                                                                    int max_in_flight) {
+    std::vector<std::optional<FileContent>> results(requests.size());
+
+    // Files the contents API has to serve instead, by repository
+    using RepoKey = std::pair<std::string, std::string>;
+    std::map<RepoKey, std::vector<size_t>> fallback;
+
+    // GraphQL string literals use JSON's escaping
+    auto quote = [](const std::string& value) { return nlohmann::json(value).dump(); };
+
+    for (size_t start = 0; start < requests.size(); start += kMaxGraphqlObjects) {
+        size_t end = std::min(requests.size(), start + kMaxGraphqlObjects);
+
+        if (!pool_.authenticated()) {
+            for (size_t i = start; i < end; i++) {
+                fallback[{requests[i].owner, requests[i].repo}].push_back(i);
+            }
+            continue;
+        }
+
+        // Group the chunk by repository: r<n> aliases a repository, f<i> a file (request index)
+        std::map<RepoKey, std::vector<size_t>> by_repo;
+        for (size_t i = start; i < end; i++) {
+            by_repo[{requests[i].owner, requests[i].repo}].push_back(i);
+        }
+
+        std::string query = "query{";
+        size_t alias = 0;
+        for (const auto& [key, indices] : by_repo) {
+            query += "r" + std::to_string(alias++) + ":repository(owner:" + quote(key.first) +
+                     ",name:" + quote(key.second) + "){";
+            for (size_t i : indices) {
+                std::string ref = requests[i].ref.empty() ? "HEAD" : requests[i].ref;
+                query += "f" + std::to_string(i) + ":object(expression:" + quote(ref + ":" + requests[i].path) +
+                         "){...on Blob{oid text isBinary isTruncated}}";
+            }
+            query += "}";
+        }
+        query += "}";
 
-    spdlog::debug("Successfully fetched {} bytes", decoded.size());
-    return decoded;
+        std::optional<nlohmann::json> data = graphql(query);
+
+        alias = 0;
+        for (const auto& [key, indices] : by_repo) {
+            std::string repo_alias = "r" + std::to_string(alias++);
+
+            if (!data) {
+                fallback[key].insert(fallback[key].end(), indices.begin(), indices.end());
+                continue;
+            }
+
+            // A missing repository comes back as null (with an error entry)
+            auto repo_node = data->find(repo_alias);
+            if (repo_node == data->end() || !repo_node->is_object()) {
+                continue;
+            }
+
+            for (size_t i : indices) {
+                // null: no such path; no oid: the path is a directory
+                auto blob = repo_node->find("f" + std::to_string(i));
+                if (blob == repo_node->end() || !blob->is_object() || !blob->contains("oid")) {
+                    continue;
+                }
+
+                const nlohmann::json& text = (*blob)["text"];
+                if (!text.is_string() || blob->value("isBinary", false) || blob->value("isTruncated", false)) {
+                    fallback[key].push_back(i);
+                    continue;
+                }
+
+                results[i] = FileContent{text.get<std::string>(), (*blob)["oid"].get<std::string>()};
+            }
+        }
+    }
+
+    for (const auto& [key, indices] : fallback) {
+        std::vector<std::string> paths;
+        for (size_t i : indices) {
+            paths.push_back(requests[i].path);
+        }
+
+        spdlog::debug("Fetching {} files of {}/{} through the contents API", paths.size(), key.first, key.second);
+        auto contents = getFileContents(key.first, key.second, paths, max_in_flight);
+        for (size_t k = 0; k < indices.size(); k++) {
+            results[indices[k]] = std::move(contents[k]);
+        }
+    }
+
+    return results;
+}
+
+std::optional<nlohmann::json> GitHubClient::graphql(const std::string& query) {
+    std::string payload = nlohmann::json{{"query", query}}.dump();
+
+    std::string url = base_url_ + "/graphql";
+    std::string fixture_key = "POST " + url + " " + payload;
+
+    for (int attempt = 0; ; attempt++) {
+        TokenState& token = pool_.select(RateResource::GRAPHQL);
+        acquire(token, RateResource::GRAPHQL);
+
+        cpr::Response r;
+        Stopwatch watch;
+        if (replaying()) {
+            r = replay(fixture_key, url);
+        } else {
+            // Not pooled: a session that has sent a body keeps attaching it to later requests
+            cpr::Session session;
+            cpr::Header headers = buildHeaders(token);
+            headers["Content-Type"] = "application/json";
+            session.SetUrl(cpr::Url{url});
+            session.SetHeader(headers);
+            session.SetConnectTimeout(cpr::ConnectTimeout{std::chrono::seconds(10)});
+            session.SetTimeout(cpr::Timeout{std::chrono::seconds(60)});
+            session.SetBody(cpr::Body{payload});
+            r = session.Post();
+            record(fixture_key, r);
+        }
+        recordRequest(url, r.error ? 0 : r.status_code, watch.elapsed());
+
+        bool retry = handleRateLimit(token, RateResource::GRAPHQL, r, attempt);
+
+        if (r.status_code != 200) {
+            if (retry && attempt < kMaxRateLimitRetries) {
+                continue;
+            }
+            spdlog::warn("GraphQL request failed: HTTP {}", r.status_code);
+            return std::nullopt;
+        }
+
+        nlohmann::json response = nlohmann::json::parse(r.text, nullptr, false);
+        if (response.is_discarded()) {
+            spdlog::warn("GraphQL response is not valid JSON");
+            return std::nullopt;
+        }
+
+        // Exceeding the point budget is reported as an error inside a 200 response
+        bool rate_limited = false;
+        if (response.contains("errors") && response["errors"].is_array()) {
+            for (const auto& error : response["errors"]) {
+                if (error.value("type", "") == "RATE_LIMITED") {
+                    rate_limited = true;
+                } else {
+                    spdlog::debug("GraphQL: {}", error.value("message", ""));
+                }
+            }
+        }
+
+        if (rate_limited && attempt < kMaxRateLimitRetries && !replaying()) {
+            spdlog::warn("GraphQL rate limit hit on token {}, backing off", token.label);
+            token.limiter.backoff(RateResource::GRAPHQL, std::chrono::seconds(60));
+            continue;
+        }
+
+        if (!response.contains("data") || !response["data"].is_object()) {
+            return std::nullopt;
+        }
+        return std::move(response["data"]);
+    }
+}
+
+// List Repository Files via the Git Trees API
+RepositoryTree GitHubClient::getTree(const std::string& owner, const std::string& repo,
+                                     const std::string& ref, bool recursive) {
+    spdlog::debug("Fetching tree: {}/{}@{}", owner, repo, ref);
+
+    // Query in the URL itself, so recursive and flat listings are recorded apart
+    std::string url = base_url_ + "/repos/" + owner + "/" + repo + "/git/trees/" + encodePath(ref);
+    cpr::Response r = get(RateResource::CORE, recursive ? url + "?recursive=1" : url);
+
+    RepositoryTree tree;
+
+    // 409 Conflict means the repository has no commits yet
+    if (r.status_code == 409) {
+        spdlog::debug("Repository is empty: {}/{}", owner, repo);
+        return tree;
+    }
+
+    // Check status
+    if (r.status_code != 200) {
+        spdlog::warn("Failed to fetch tree for {}/{}: HTTP {}", owner, repo, r.status_code);
+        throw std::runtime_error("Failed to fetch tree for " + owner + "/" + repo);
+    }
+
+    // Parse JSON response
+    nlohmann::json response = nlohmann::json::parse(r.text);
+
+    tree.truncated = response.value("truncated", false);
+    if (tree.truncated) {
+        spdlog::warn("Tree listing for {}/{} was truncated by GitHub", owner, repo);
+    }
+
+    if (response.contains("tree")) {
+        tree.entries.reserve(response["tree"].size());
+        for (const auto& item : response["tree"]) {
+            TreeEntry entry;
+            entry.path = item["path"];
+            entry.sha = item["sha"];
+            entry.type = item["type"];
+            entry.size = item.value("size", 0L);
+            tree.entries.push_back(std::move(entry));
+        }
+    }
+
+    spdlog::debug("Tree has {} entries", tree.entries.size());
+    return tree;
+}
+
+bool GitHubClient::streamTarball(const std::string& owner, const std::string& repo,
+                                 const std::string& ref, TarballReader& reader) {
+    spdlog::debug("Streaming tarball: {}/{}@{}", owner, repo, ref);
+
+    // Redirects to codeload.github.com, which serves the archive itself
+    std::string url = base_url_ + "/repos/" + owner + "/" + repo + "/tarball/" + encodePath(ref);
+
+    if (replaying()) {
+        cpr::Response r = replay("GET " + url, url);
+        if (r.text.empty() || static_cast<unsigned char>(r.text[0]) != 0x1f) {
+            spdlog::debug("No tarball for {}/{}: HTTP {}", owner, repo, r.status_code);
+            return false;
+        }
+
+        // Same chunking as a download, so the reader sees the archive arrive in pieces
+        constexpr size_t kChunk = 64 * 1024;
+        for (size_t pos = 0; pos < r.text.size(); pos += kChunk) {
+            if (!reader.feed(r.text.data() + pos, std::min(kChunk, r.text.size() - pos))) {
+                break;
+            }
+        }
+        return reader.finish();
+    }
+
+    for (int attempt = 0; ; attempt++) {
+        TokenState& token = pool_.select(RateResource::CORE);
+        acquire(token, RateResource::CORE);
+
+        // Not pooled: the write callback and the longer timeout belong to this transfer
+        cpr::Session session;
+        session.SetUrl(cpr::Url{url});
+        session.SetHeader(buildHeaders(token));
+        session.SetConnectTimeout(cpr::ConnectTimeout{std::chrono::seconds(10)});
+        session.SetTimeout(cpr::Timeout{std::chrono::seconds(300)});
+
+        // Anything that isn't gzip (an error or rate limit message) is kept for inspection
+        bool started = false;
+        bool archive = false;
+        std::string error_body;
+        std::string recording;  // The whole archive, when recording fixtures
+        session.SetWriteCallback(cpr::WriteCallback{[&](const auto& data, intptr_t) -> bool {
+            if (!started) {
+                started = true;
+                archive = !data.empty() && static_cast<unsigned char>(data[0]) == 0x1f;
+            }
+            if (!archive) {
+                if (error_body.size() < 64 * 1024) {
+                    error_body.append(data.data(), data.size());
+                }
+                return true;
+            }
+            if (fixtures_) {
+                recording.append(data.data(), data.size());
+            }
+            return reader.feed(data.data(), data.size());
+        }});
+
+        Stopwatch watch;
+        cpr::Response r = session.Get();
+        recordRequest(url, r.error ? 0 : r.status_code, watch.elapsed());
+        if (fixtures_) {
+            r.text = archive ? std::move(recording) : error_body;
+            record("GET " + url, r);
+        }
+        r.text = std::move(error_body);
+
+        bool retry = handleRateLimit(token, RateResource::CORE, r, attempt);
+        if (!archive) {
+            if (retry && attempt < kMaxRateLimitRetries) {
+                continue;  // Nothing reached the reader yet, so it can start over
+            }
+            spdlog::debug("No tarball for {}/{}: HTTP {}", owner, repo, r.status_code);
+            return false;
+        }
+
+        if (!reader.finish()) {
+            spdlog::debug("Tarball of {}/{} ended early: {}", owner, repo,
+                          !reader.error().empty() ? reader.error() : r.error.message);
+            return false;
+        }
+        return true;
+    }
 }
 
 } 
@@ -0,0 +1,145 @@
+#include "http_cache.h"
+#include "atomic_file.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace overwatch {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[] = "OWHC1";
+
+} // namespace
+
+HttpCache::HttpCache(const std::string& dir, uint64_t max_bytes) : dir_(dir), max_bytes_(max_bytes) {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (ec) {
+        spdlog::warn("Could not create HTTP cache directory {}: {}", dir_, ec.message());
+    }
+
+    // A cache left over budget by an earlier run (or a smaller budget) is trimmed now
+    evict();
+}
+
+std::optional<CachedResponse> HttpCache::load(const std::string& key) const {
+    std::string path = hashedPath(dir_, key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+
+    // Header lines: magic, key, ETag, Last-Modified; the body follows verbatim
+    std::string magic;
+    std::string stored_key;
+    CachedResponse response;
+    if (!std::getline(in, magic) || magic != kMagic ||
+        !std::getline(in, stored_key) || stored_key != key ||
+        !std::getline(in, response.etag) || !std::getline(in, response.last_modified)) {
+        return std::nullopt;
+    }
+
+    response.body.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    // The mtime is the entry's last use, which is what eviction goes by
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return response;
+}
+
+void HttpCache::store(const std::string& key, const CachedResponse& response) {
+    // Keys and validators are single header lines; anything else can't round-trip
+    auto single_line = [](const std::string& value) { return value.find('\n') == std::string::npos; };
+    if (!single_line(key) || !single_line(response.etag) || !single_line(response.last_modified)) {
+        return;
+    }
+    uint64_t entry_bytes = sizeof(kMagic) + key.size() + response.etag.size() + response.last_modified.size() + 3 +
+                           response.body.size();
+    if (entry_bytes > max_bytes_) {
+        return;
+    }
+
+    std::string path = hashedPath(dir_, key);
+    std::error_code ec;
+    uint64_t replaced_bytes = fs::file_size(path, ec);
+    if (ec) {
+        replaced_bytes = 0;
+    }
+
+    bool written = writeFileAtomically(path, [&](std::ostream& out) {
+        out << kMagic << '\n' << key << '\n' << response.etag << '\n' << response.last_modified << '\n';
+        out.write(response.body.data(), static_cast<std::streamsize>(response.body.size()));
+    });
+    if (!written) {
+        spdlog::debug("Could not write HTTP cache entry for {}", key);
+        return;
+    }
+
+    // Concurrent stores of one key can leave this off (even wrap it); evict() recounts from disk
+    uint64_t total = entry_bytes >= replaced_bytes ? size_bytes_ += entry_bytes - replaced_bytes
+                                                   : size_bytes_ -= replaced_bytes - entry_bytes;
+    if (total > max_bytes_) {
+        evict();
+    }
+}
+
+void HttpCache::evict() {
+    // One thread evicting is enough; the others carry on storing
+    std::unique_lock<std::mutex> lock(evict_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+
+    struct Entry {
+        fs::file_time_type used;
+        uint64_t bytes;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec)) {
+            continue;
+        }
+        Entry entry{it->last_write_time(entry_ec), it->file_size(entry_ec), it->path()};
+        if (entry_ec) {
+            continue;
+        }
+        total += entry.bytes;
+        // Temporary files belong to stores in flight; they count but aren't evicted
+        if (entry.path.filename().string().find(".tmp.") == std::string::npos) {
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    if (total > max_bytes_) {
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.used < b.used; });
+
+        uint64_t low_water = max_bytes_ / 4 * 3;
+        size_t removed = 0;
+        for (const Entry& entry : entries) {
+            if (total <= low_water) {
+                break;
+            }
+            if (fs::remove(entry.path, ec)) {
+                total -= entry.bytes;
+                removed++;
+            }
+        }
+        spdlog::debug("Evicted {} HTTP cache entries, {} bytes left in {}", removed, total, dir_);
+    }
+
+    size_bytes_ = total;
+}
+
+} // namespace overwatch
@@ -0,0 +1,101 @@
+#include "http_fixtures.h"
+#include "atomic_file.h"
+#include <spdlog/spdlog.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace overwatch {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char kMagic[] = "OWHF1";
+
+bool singleLine(const std::string& value) {
+    return value.find('\n') == std::string::npos && value.find('\r') == std::string::npos;
+}
+
+} // namespace
+
+HttpFixtures::HttpFixtures(const std::string& dir, Mode mode) : dir_(dir), mode_(mode) {
+    if (mode_ == Mode::REPLAY) {
+        if (!fs::is_directory(dir_)) {
+            throw std::runtime_error("No fixture directory at " + dir_);
+        }
+        return;
+    }
+
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (ec) {
+        spdlog::warn("Could not create fixture directory {}: {}", dir_, ec.message());
+    }
+}
+
+std::optional<RecordedResponse> HttpFixtures::load(const std::string& key) const {
+    std::ifstream in(hashedPath(dir_, key), std::ios::binary);
+    if (!in) {
+        return std::nullopt;
+    }
+
+    // Header lines: magic, key, status, header count, "Name: value" per header; the body follows verbatim
+    std::string magic;
+    std::string stored_key;
+    std::string status;
+    std::string count;
+    if (!std::getline(in, magic) || magic != kMagic ||
+        !std::getline(in, stored_key) || stored_key != key ||
+        !std::getline(in, status) || !std::getline(in, count)) {
+        return std::nullopt;
+    }
+
+    RecordedResponse response;
+    try {
+        response.status_code = std::stol(status);
+        for (unsigned long i = std::stoul(count); i > 0; i--) {
+            std::string line;
+            if (!std::getline(in, line)) {
+                return std::nullopt;
+            }
+            size_t colon = line.find(": ");
+            if (colon != std::string::npos) {
+                response.headers.emplace_back(line.substr(0, colon), line.substr(colon + 2));
+            }
+        }
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    response.body.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return response;
+}
+
+void HttpFixtures::store(const std::string& key, const RecordedResponse& response) const {
+    if (!singleLine(key)) {
+        return;
+    }
+
+    // Headers that can't round-trip as one line are dropped rather than corrupting the entry
+    std::vector<const std::pair<std::string, std::string>*> headers;
+    for (const auto& header : response.headers) {
+        if (singleLine(header.first) && singleLine(header.second)) {
+            headers.push_back(&header);
+        }
+    }
+
+    bool written = writeFileAtomically(hashedPath(dir_, key), [&](std::ostream& out) {
+        out << kMagic << '\n' << key << '\n' << response.status_code << '\n' << headers.size() << '\n';
+        for (const auto* header : headers) {
+            out << header->first << ": " << header->second << '\n';
+        }
+        out.write(response.body.data(), static_cast<std::streamsize>(response.body.size()));
+    });
+    if (!written) {
+        spdlog::debug("Could not write fixture for {}", key);
+    }
+}
+
+} // namespace overwatch
@@ -0,0 +1,225 @@
+#include "literal_prefilter.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace overwatch {
+
+std::string LiteralPrefilter::extractLiteral(const std::string& regex) {
+    std::string best;
+    std::string run;
+    size_t n = regex.size();
+    size_t i = 0;
+
+    auto flush = [&best, &run]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    while (i < n) {
+        char c = regex[i];
+        bool literal = false;
+        char value = 0;
+        size_t next = i + 1;
+
+        if (c == '\\') {
+            if (i + 1 >= n) {
+                break;
+            }
+            char escaped = regex[i + 1];
+            next = i + 2;
+
+            if (std::isalnum(static_cast<unsigned char>(escaped))) {
+                // \d, \w, \s, \b, \xHH, \uHHHH, \p{..}: not a literal, skip any arguments
+                if (escaped == 'x') {
+                    next = std::min(n, i + 4);
+                } else if (escaped == 'u') {
+                    next = std::min(n, i + 6);
+                } else if ((escaped == 'p' || escaped == 'P') && next < n && regex[next] == '{') {
+                    size_t close = regex.find('}', next);
+                    next = close == std::string::npos ? n : close + 1;
+                }
+            } else {
+                // Escaped punctuation (\. \- \/ ...) is the character itself
+                literal = true;
+                value = escaped;
+            }
+        } else if (c == '[') {
+            // Character class - skip to the closing bracket
+            size_t j = i + 1;
+            if (j < n && regex[j] == '^') j++;
+            if (j < n && regex[j] == ']') j++;
+            while (j < n && regex[j] != ']') {
+                if (regex[j] == '\\') j++;
+                j++;
+            }
+            next = std::min(n, j + 1);
+        } else if (c == '(') {
+            // Group - skip to the matching parenthesis
+            int depth = 1;
+            size_t j = i + 1;
+            while (j < n && depth > 0) {
+                if (regex[j] == '\\') {
+                    j += 2;
+                    continue;
+                }
+                if (regex[j] == '[') {
+                    j++;
+                    while (j < n && regex[j] != ']') {
+                        if (regex[j] == '\\') j++;
+                        j++;
+                    }
+                } else if (regex[j] == '(') {
+                    depth++;
+                } else if (regex[j] == ')') {
+                    depth--;
+                }
+                j++;
+            }
+            next = std::min(n, j);
+        } else if (c == '|') {
+            // Top-level alternation: no single literal is required
+            return "";
+        } else if (c != '.' && c != '^' && c != '$' && c != '?' && c != '*' &&
+                   c != '+' && c != '{' && c != ')') {
+            literal = true;
+            value = c;
+        }
+
+        // A following quantifier decides whether the atom is required
+        bool optional = false;
+        bool repeated = false;
+        size_t q = next;
+        if (q < n) {
+            if (regex[q] == '?' || regex[q] == '*') {
+                optional = true;
+                q++;
+            } else if (regex[q] == '+') {
+                repeated = true;
+                q++;
+            } else if (regex[q] == '{') {
+                size_t close = regex.find('}', q);
+                if (close != std::string::npos) {
+                    int min_count = std::atoi(regex.substr(q + 1, close - q - 1).c_str());
+                    optional = min_count == 0;
+                    repeated = !optional;
+                    q = close + 1;
+                }
+            }
+            if ((optional || repeated) && q < n && regex[q] == '?') {
+                q++;  // Lazy quantifier
+            }
+        }
+
+        if (literal && !optional) {
+            run += static_cast<char>(std::tolower(static_cast<unsigned char>(value)));
+            if (repeated) {
+                flush();  // What follows a repeat isn't adjacent to this run
+            }
+        } else {
+            flush();
+        }
+
+        i = q;
+    }
+
+    flush();
+    return best.size() >= kMinExtractedLength ? best : "";
+}
+
+size_t LiteralPrefilter::add(const std::string& literal) {
+    std::string lowered = literal;
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+    auto it = std::find(literals_.begin(), literals_.end(), lowered);
+    if (it != literals_.end()) {
+        return static_cast<size_t>(it - literals_.begin());
+    }
+
+    // OR-ing 0x20 folds ASCII case; it also folds a few non-letters together,
+    // which only adds candidates that the exact check in scan() rejects
+    Fingerprint fingerprint;
+    std::memset(fingerprint.first, static_cast<unsigned char>(lowered[0]) | 0x20, sizeof(fingerprint.first));
+    std::memset(fingerprint.second, static_cast<unsigned char>(lowered[1]) | 0x20, sizeof(fingerprint.second));
+
+    literals_.push_back(lowered);
+    fingerprints_.push_back(fingerprint);
+    return literals_.size() - 1;
+}
+
+bool LiteralPrefilter::matchesAt(std::string_view text, size_t offset, const std::string& literal) const {
+    if (offset + literal.size() > text.size()) {
+        return false;
+    }
+
+    for (size_t k = 0; k < literal.size(); k++) {
+        if (std::tolower(static_cast<unsigned char>(text[offset + k])) != static_cast<unsigned char>(literal[k])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LiteralPrefilter::scanScalar(std::string_view text, size_t from, LiteralHits& hits) const {
+    for (size_t pos = from; pos < text.size(); pos++) {
+        unsigned char folded = static_cast<unsigned char>(text[pos]) | 0x20;
+        for (size_t id = 0; id < literals_.size(); id++) {
+            if (folded == (static_cast<unsigned char>(literals_[id][0]) | 0x20) &&
+                matchesAt(text, pos, literals_[id])) {
+                hits[id].push_back(pos);
+            }
+        }
+    }
+}
+
+void LiteralPrefilter::scan(std::string_view text, LiteralHits& hits) const {
+    hits.clear();
+    hits.resize(literals_.size());
+    if (literals_.empty()) {
+        return;
+    }
+
+    size_t pos = 0;
+
+#if defined(__SSE2__)
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const char* data = text.data();
+
+    // Each block also reads one byte past its end for the second fingerprint byte
+    for (; pos + 17 <= text.size(); pos += 16) {
+        __m128i b0 = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)), fold);
+        __m128i b1 = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + 1)), fold);
+
+        __m128i any = _mm_setzero_si128();
+        for (const auto& fp : fingerprints_) {
+            __m128i first = _mm_load_si128(reinterpret_cast<const __m128i*>(fp.first));
+            __m128i second = _mm_load_si128(reinterpret_cast<const __m128i*>(fp.second));
+            any = _mm_or_si128(any, _mm_and_si128(_mm_cmpeq_epi8(b0, first), _mm_cmpeq_epi8(b1, second)));
+        }
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(any));
+        while (mask != 0) {
+            size_t offset = pos + static_cast<size_t>(__builtin_ctz(mask));
+            mask &= mask - 1;
+
+            for (size_t id = 0; id < literals_.size(); id++) {
+                if (matchesAt(text, offset, literals_[id])) {
+                    hits[id].push_back(offset);
+                }
+            }
+        }
+    }
+#endif
+
+    scanScalar(text, pos, hits);
+}
+
+} // namespace overwatch
@@ -0,0 +1,300 @@
+#include "local_directory_source.h"
+#include <spdlog/spdlog.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace overwatch {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Whole file in one read() into a string sized from fstat (nullopt if it can't be
+// opened or isn't a regular file). The string is what FileContent carries, so this
+// is the only copy; a mapping would still have to be copied into it
+std::optional<std::string> readFile(const fs::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    std::string content(static_cast<size_t>(st.st_size), '\0');
+    size_t filled = 0;
+    while (filled < content.size()) {
+        ssize_t n = ::read(fd, content.data() + filled, content.size() - filled);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;  // Error, or the file shrank while being read
+        }
+        filled += static_cast<size_t>(n);
+    }
+    ::close(fd);
+
+    if (filled < content.size()) {
+        return std::nullopt;
+    }
+    return content;
+}
+
+// Relative paths only, and none that climb out of the repository
+bool safeRelative(const std::string& path) {
+    if (path.empty() || path[0] == '/') {
+        return false;
+    }
+    for (const auto& part : fs::path(path)) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<fs::path> sortedSubdirectories(const fs::path& dir) {
+    std::vector<fs::path> dirs;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied, ec)) {
+        std::string name = entry.path().filename().string();
+        if (!name.empty() && name[0] != '.' && entry.is_directory(ec) && !entry.is_symlink(ec)) {
+            dirs.push_back(entry.path());
+        }
+    }
+    std::sort(dirs.begin(), dirs.end());
+    return dirs;
+}
+
+} // namespace
+
+LocalDirectorySource::LocalDirectorySource(const std::string& root, bool corpus, int walk_threads)
+    : corpus_(corpus),
+      walk_threads_(walk_threads > 0 ? walk_threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()))) {
+    std::error_code ec;
+    root_ = fs::canonical(root, ec);
+    if (ec || !fs::is_directory(root_)) {
+        throw std::runtime_error("Not a directory: " + root);
+    }
+}
+
+fs::path LocalDirectorySource::repositoryPath(const std::string& owner, const std::string& repo) const {
+    if (!corpus_) {
+        return root_;
+    }
+    if (!safeRelative(owner) || !safeRelative(repo) ||
+        owner.find('/') != std::string::npos || repo.find('/') != std::string::npos) {
+        throw std::runtime_error("Invalid repository name: " + owner + "/" + repo);
+    }
+    return root_ / owner / repo;
+}
+
+std::vector<Repository> LocalDirectorySource::listRepositories() const {
+    auto make = [](const std::string& owner, const fs::path& dir) {
+        Repository repo;
+        repo.owner = owner;
+        repo.name = dir.filename().string();
+        repo.url = dir.string();
+        repo.stars = 0;
+        repo.archived = false;
+        return repo;
+    };
+
+    std::vector<Repository> repositories;
+    if (!corpus_) {
+        repositories.push_back(make("local", root_));
+        return repositories;
+    }
+
+    for (const auto& owner_dir : sortedSubdirectories(root_)) {
+        std::string owner = owner_dir.filename().string();
+        for (const auto& repo_dir : sortedSubdirectories(owner_dir)) {
+            repositories.push_back(make(owner, repo_dir));
+        }
+    }
+    return repositories;
+}
+
+int LocalDirectorySource::searchRepositoriesPaged(const std::string& query, int max_results, const SearchOptions&,
+                                                  const std::function<bool(SearchPage&)>& on_page) {
+    if (!query.empty()) {
+        spdlog::debug("Local directory source ignores the query: {}", query);
+    }
+
+    std::vector<Repository> repositories = listRepositories();
+    long total = static_cast<long>(repositories.size());
+    if (max_results > 0 && repositories.size() > static_cast<size_t>(max_results)) {
+        repositories.resize(static_cast<size_t>(max_results));
+    }
+    spdlog::info("Found {} repositories under {}", total, root_.string());
+
+    int delivered = 0;
+    for (size_t start = 0, page = 1; start < repositories.size(); start += kPageSize, page++) {
+        SearchPage current;
+        current.page = static_cast<int>(page);
+        current.total_count = total;
+        size_t end = std::min(repositories.size(), start + kPageSize);
+        std::move(repositories.begin() + static_cast<long>(start), repositories.begin() + static_cast<long>(end),
+                  std::back_inserter(current.repositories));
+
+        delivered += static_cast<int>(current.repositories.size());
+        if (!on_page(current)) {
+            break;
+        }
+    }
+    return delivered;
+}
+
+RepositoryTree LocalDirectorySource::getTree(const std::string& owner, const std::string& repo,
+                                             const std::string&, bool recursive) {
+    fs::path base = repositoryPath(owner, repo);
+    if (!fs::is_directory(base)) {
+        throw std::runtime_error("No such repository directory: " + base.string());
+    }
+
+    RepositoryTree tree;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<fs::path> pending{base};
+    int active = 0;  // Directories being listed right now
+
+    // Each thread lists one directory at a time and queues the subdirectories it finds
+    auto walk = [&]() {
+        while (true) {
+            fs::path dir;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !pending.empty() || active == 0; });
+                if (pending.empty()) {
+                    return;
+                }
+                dir = std::move(pending.front());
+                pending.pop_front();
+                active++;
+            }
+
+            std::vector<TreeEntry> entries;
+            std::vector<fs::path> subdirs;
+            std::error_code ec;
+            for (const auto& entry : fs::directory_iterator(dir, fs::directory_options::skip_permission_denied, ec)) {
+                fs::file_status status = entry.symlink_status(ec);
+                if (ec || fs::is_symlink(status)) {
+                    continue;
+                }
+
+                std::string path = entry.path().lexically_relative(base).generic_string();
+                if (fs::is_directory(status)) {
+                    // GitHub trees never contain the .git directory either
+                    if (entry.path().filename() == ".git") {
+                        continue;
+                    }
+                    entries.push_back({path, "", "tree", 0});
+                    if (recursive) {
+                        subdirs.push_back(entry.path());
+                    }
+                } else if (fs::is_regular_file(status)) {
+                    entries.push_back({path, "", "blob", static_cast<long>(entry.file_size(ec))});
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::move(entries.begin(), entries.end(), std::back_inserter(tree.entries));
+                std::move(subdirs.begin(), subdirs.end(), std::back_inserter(pending));
+                active--;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < walk_threads_; i++) {
+        threads.emplace_back(walk);
+    }
+    walk();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Same order on every run, whatever the threads did
+    std::sort(tree.entries.begin(), tree.entries.end(),
+              [](const TreeEntry& a, const TreeEntry& b) { return a.path < b.path; });
+
+    spdlog::debug("Walked {}: {} entries", base.string(), tree.entries.size());
+    return tree;
+}
+
+std::vector<std::optional<FileContent>> LocalDirectorySource::getFileContents(const std::string& owner,
+                                                                              const std::string& repo,
+                                                                              const std::vector<std::string>& paths,
+                                                                              int max_in_flight) {
+    std::vector<std::optional<FileContent>> results(paths.size());
+    fs::path base = repositoryPath(owner, repo);
+
+    std::atomic<size_t> next{0};
+    auto read = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            if (!safeRelative(paths[i])) {
+                continue;
+            }
+            if (auto content = readFile(base / paths[i])) {
+                results[i] = FileContent{std::move(*content), ""};
+            }
+        }
+    };
+
+    size_t threads = std::min(paths.size(), static_cast<size_t>(std::max(1, max_in_flight)));
+    std::vector<std::thread> readers;
+    for (size_t i = 1; i < threads; i++) {
+        readers.emplace_back(read);
+    }
+    read();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    return results;
+}
+
+std::vector<std::optional<FileContent>> LocalDirectorySource::batchGetFiles(const std::vector<FileRequest>& requests,
+                                                                            int max_in_flight) {
+    std::vector<std::optional<FileContent>> results(requests.size());
+
+    std::map<std::pair<std::string, std::string>, std::vector<size_t>> by_repo;
+    for (size_t i = 0; i < requests.size(); i++) {
+        by_repo[{requests[i].owner, requests[i].repo}].push_back(i);
+    }
+
+    for (const auto& [key, indices] : by_repo) {
+        std::vector<std::string> paths;
+        for (size_t i : indices) {
+            paths.push_back(requests[i].path);
+        }
+        auto contents = getFileContents(key.first, key.second, paths, max_in_flight);
+        for (size_t k = 0; k < indices.size(); k++) {
+            results[indices[k]] = std::move(contents[k]);
+        }
+    }
+
+    return results;
+}
+
+bool LocalDirectorySource::streamTarball(const std::string&, const std::string&, const std::string&, TarballReader&) {
+    return false;
+}
+
+} // namespace overwatch
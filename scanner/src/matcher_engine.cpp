@@ -0,0 +1,205 @@
+#include "matcher_engine.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
+
+#ifdef OVERWATCH_HAVE_RE2
+#include <re2/re2.h>
+#include <re2/set.h>
+#endif
+
+namespace overwatch {
+
+namespace {
+
+/**
+ * Fallback engine: one std::regex per pattern, no multi-pattern pass
+ */
+class StdRegexEngine : public MatcherEngine {
+public:
+    std::string name() const override { return "std"; }
+
+    bool linearTime() const override { return false; }
+
+    void compile(const std::vector<std::string>& regexes) override {
+        regexes_.clear();
+        regexes_.reserve(regexes.size());
+
+        for (const auto& source : regexes) {
+            try {
+                regexes_.emplace_back(source, std::regex::icase);
+            } catch (const std::regex_error& e) {
+                throw std::runtime_error("Invalid regex '" + source + "': " + e.what());
+            }
+        }
+    }
+
+    void matchingPatterns(std::string_view, const std::pmr::vector<size_t>& candidates,
+                          std::pmr::vector<size_t>& result) const override {
+        // std::regex has no set mode, and searching a whole file at once risks deep
+        // recursion on long inputs - leave the per-line pass to decide
+        result.insert(result.end(), candidates.begin(), candidates.end());
+    }
+
+    bool find(size_t pattern, std::string_view text, size_t& start, size_t& length) const override {
+        // Reused, so its submatch storage is only allocated once per thread
+        thread_local std::cmatch match;
+        if (!std::regex_search(text.data(), text.data() + text.size(), match, regexes_[pattern])) {
+            return false;
+        }
+
+        start = static_cast<size_t>(match.position(0));
+        length = static_cast<size_t>(match.length(0));
+        return true;
+    }
+
+private:
+    std::vector<std::regex> regexes_;
+};
+
+#ifdef OVERWATCH_HAVE_RE2
+/**
+ * RE2 engine: all patterns in one RE2::Set automaton for the file-level pass,
+ * plus one RE2 per pattern to locate matches inside lines
+ */
+class Re2Engine : public MatcherEngine {
+public:
+    std::string name() const override { return "re2"; }
+
+    bool linearTime() const override { return true; }
+
+    void compile(const std::vector<std::string>& regexes) override {
+        RE2::Options options;
+        options.set_case_sensitive(false);
+        options.set_log_errors(false);
+
+        regexes_.clear();
+        regexes_.reserve(regexes.size());
+        set_ = std::make_unique<RE2::Set>(options, RE2::UNANCHORED);
+
+        for (const auto& source : regexes) {
+            auto re = std::make_unique<RE2>(source, options);
+            if (!re->ok()) {
+                throw std::runtime_error("Invalid regex '" + source + "': " + re->error());
+            }
+            regexes_.push_back(std::move(re));
+
+            // Patterns run per line, so ^ and $ must mean line boundaries in the file-level pass
+            std::string error;
+            if (set_->Add("(?m)" + source, &error) < 0) {
+                throw std::runtime_error("Invalid regex '" + source + "': " + error);
+            }
+        }
+
+        if (!set_->Compile()) {
+            throw std::runtime_error("Failed to compile RE2 pattern set (out of memory)");
+        }
+    }
+
+    void matchingPatterns(std::string_view text, const std::pmr::vector<size_t>& candidates,
+                          std::pmr::vector<size_t>& result) const override {
+        // Reused, so it keeps its capacity from one file to the next
+        thread_local std::vector<int> hits;
+        hits.clear();
+        if (!set_->Match(re2::StringPiece(text.data(), text.size()), &hits)) {
+            return;
+        }
+
+        std::sort(hits.begin(), hits.end());
+
+        for (size_t candidate : candidates) {
+            if (std::binary_search(hits.begin(), hits.end(), static_cast<int>(candidate))) {
+                result.push_back(candidate);
+            }
+        }
+    }
+
+    bool find(size_t pattern, std::string_view text, size_t& start, size_t& length) const override {
+        re2::StringPiece input(text.data(), text.size());
+        re2::StringPiece match;
+        if (!regexes_[pattern]->Match(input, 0, input.size(), RE2::UNANCHORED, &match, 1)) {
+            return false;
+        }
+
+        start = static_cast<size_t>(match.data() - text.data());
+        length = match.size();
+        return true;
+    }
+
+private:
+    std::vector<std::unique_ptr<RE2>> regexes_;
+    std::unique_ptr<RE2::Set> set_;
+};
+
+/**
+ * "auto" engine: RE2, unless it rejects a pattern std::regex accepts
+ * RE2 has no backreferences or lookaround, so a pattern set that needs
+ * them is compiled with std::regex instead - all of it, so every pattern
+ * still goes through one engine - with a warning naming the pattern.
+ */
+class AutoEngine : public MatcherEngine {
+public:
+    AutoEngine() : engine_(std::make_unique<Re2Engine>()) {}
+
+    std::string name() const override { return engine_->name(); }
+
+    bool linearTime() const override { return engine_->linearTime(); }
+
+    void compile(const std::vector<std::string>& regexes) override {
+        auto re2 = std::make_unique<Re2Engine>();
+        try {
+            re2->compile(regexes);
+            engine_ = std::move(re2);
+        } catch (const std::runtime_error& e) {
+            // A pattern std::regex rejects too throws from here, as with an explicit engine
+            auto fallback = std::make_unique<StdRegexEngine>();
+            fallback->compile(regexes);
+            spdlog::warn("RE2 can't compile the pattern set ({}); falling back to std::regex", e.what());
+            engine_ = std::move(fallback);
+        }
+    }
+
+    void matchingPatterns(std::string_view text, const std::pmr::vector<size_t>& candidates,
+                          std::pmr::vector<size_t>& result) const override {
+        engine_->matchingPatterns(text, candidates, result);
+    }
+
+    bool find(size_t pattern, std::string_view text, size_t& start, size_t& length) const override {
+        return engine_->find(pattern, text, start, length);
+    }
+
+private:
+    std::unique_ptr<MatcherEngine> engine_;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<MatcherEngine> MatcherEngine::create(const std::string& name) {
+#ifdef OVERWATCH_HAVE_RE2
+    if (name == "auto") {
+        return std::make_unique<AutoEngine>();
+    }
+    if (name == "re2") {
+        return std::make_unique<Re2Engine>();
+    }
+#endif
+
+    if (name == "auto" || name == "std") {
+        return std::make_unique<StdRegexEngine>();
+    }
+
+    throw std::runtime_error("Unknown matcher engine: " + name);
+}
+
+std::vector<std::string> MatcherEngine::available() {
+    std::vector<std::string> engines;
+#ifdef OVERWATCH_HAVE_RE2
+    engines.push_back("re2");
+#endif
+    engines.push_back("std");
+    return engines;
+}
+
+} // namespace overwatch
@@ -0,0 +1,230 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+namespace overwatch {
+
+namespace {
+
+std::string escapeLabel(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// {a="1",b="2"}, with extra appended after the series' own labels ("" if none at all)
+std::string formatLabels(const MetricLabels& labels, const std::string& extra = "") {
+    std::string out;
+    for (const auto& [name, value] : labels) {
+        out += (out.empty() ? "" : ",") + name + "=\"" + escapeLabel(value) + "\"";
+    }
+    if (!extra.empty()) {
+        out += (out.empty() ? "" : ",") + extra;
+    }
+    return out.empty() ? "" : "{" + out + "}";
+}
+
+std::string formatSeconds(uint64_t nanos) {
+    std::ostringstream out;
+    out << std::setprecision(9) << static_cast<double>(nanos) / 1e9;
+    return out.str();
+}
+
+} // namespace
+
+std::string formatDuration(uint64_t nanos) {
+    char buffer[32];
+    double value = static_cast<double>(nanos);
+    if (nanos < 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%lluns", static_cast<unsigned long long>(nanos));
+    } else if (nanos < 1000 * 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fus", value / 1e3);
+    } else if (nanos < 1000ULL * 1000 * 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%.2fms", value / 1e6);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2fs", value / 1e9);
+    }
+    return buffer;
+}
+
+size_t Histogram::bucketOf(uint64_t nanos) {
+    if (nanos < kSubBuckets) {
+        return static_cast<size_t>(nanos);
+    }
+
+    int msb = 63 - __builtin_clzll(nanos);
+    if (msb >= kMaxBits) {
+        return kBuckets - 1;
+    }
+
+    // Range r holds [16 << (r-1), 16 << r), split into 16 steps of 1 << (r-1)
+    size_t range = static_cast<size_t>(msb - kSubBucketBits + 1);
+    size_t sub = static_cast<size_t>((nanos >> (msb - kSubBucketBits)) & (kSubBuckets - 1));
+    return range * kSubBuckets + sub;
+}
+
+uint64_t Histogram::bucketMidpoint(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t range = bucket / kSubBuckets;
+    uint64_t sub = bucket % kSubBuckets;
+    uint64_t width = 1ULL << (range - 1);
+    return ((kSubBuckets + sub) << (range - 1)) + width / 2;
+}
+
+void Histogram::record(uint64_t nanos) {
+    buckets_[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(nanos, std::memory_order_relaxed);
+
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (nanos > seen && !max_.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t Histogram::quantile(double q) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the wanted value, 1-based
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) *
+                                                                           static_cast<double>(total))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucketMidpoint(i), max());
+        }
+    }
+    return max();  // Buckets were still being updated while count_ was read
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Series& MetricsRegistry::lookup(const std::string& name, const MetricLabels& labels,
+                                                 const std::string& help, Kind kind) {
+    std::string key = name + formatLabels(labels);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = series_[key];
+    if (!slot) {
+        slot = std::make_unique<Series>();
+        slot->name = name;
+        slot->labels = labels;
+        slot->kind = kind;
+        if (kind == Kind::COUNTER) {
+            slot->counter = std::make_unique<Counter>();
+        } else {
+            slot->histogram = std::make_unique<Histogram>();
+        }
+    }
+    if (!help.empty()) {
+        help_.emplace(name, help);
+    }
+    return *slot;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const MetricLabels& labels, const std::string& help) {
+    Series& series = lookup(name, labels, help, Kind::COUNTER);
+    return *series.counter;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const MetricLabels& labels, const std::string& help) {
+    Series& series = lookup(name, labels, help, Kind::HISTOGRAM);
+    return *series.histogram;
+}
+
+std::string MetricsRegistry::prometheus() const {
+    static const double kQuantiles[] = {0.5, 0.9, 0.99};
+
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Keys start with the name, so every series of a metric is contiguous
+    std::string current;
+    for (const auto& [key, series] : series_) {
+        if (series->name != current) {
+            current = series->name;
+            auto help = help_.find(current);
+            if (help != help_.end()) {
+                out << "# HELP " << current << " " << help->second << "\n";
+            }
+            out << "# TYPE " << current << (series->kind == Kind::COUNTER ? " counter" : " summary") << "\n";
+        }
+
+        if (series->kind == Kind::COUNTER) {
+            out << key << " " << series->counter->value() << "\n";
+            continue;
+        }
+
+        const Histogram& h = *series->histogram;
+        for (double q : kQuantiles) {
+            std::ostringstream quantile;
+            quantile << "quantile=\"" << q << "\"";
+            out << current << formatLabels(series->labels, quantile.str()) << " "
+                << formatSeconds(h.quantile(q)) << "\n";
+        }
+        out << current << "_sum" << formatLabels(series->labels) << " " << formatSeconds(h.sum()) << "\n";
+        out << current << "_count" << formatLabels(series->labels) << " " << h.count() << "\n";
+    }
+
+    return out.str();
+}
+
+void MetricsRegistry::printSummary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t width = 6;
+    for (const auto& [key, series] : series_) {
+        width = std::max(width, key.size());
+    }
+
+    out << "\n" << std::left << std::setw(static_cast<int>(width)) << "Timing" << std::right
+        << std::setw(10) << "count" << std::setw(11) << "p50" << std::setw(11) << "p90"
+        << std::setw(11) << "p99" << std::setw(11) << "max" << std::setw(11) << "total" << "\n";
+
+    for (const auto& [key, series] : series_) {
+        if (series->kind != Kind::HISTOGRAM || series->histogram->count() == 0) {
+            continue;
+        }
+        const Histogram& h = *series->histogram;
+        out << std::left << std::setw(static_cast<int>(width)) << key << std::right
+            << std::setw(10) << h.count()
+            << std::setw(11) << formatDuration(h.quantile(0.5))
+            << std::setw(11) << formatDuration(h.quantile(0.9))
+            << std::setw(11) << formatDuration(h.quantile(0.99))
+            << std::setw(11) << formatDuration(h.max())
+            << std::setw(11) << formatDuration(h.sum()) << "\n";
+    }
+
+    out << "\n" << std::left << std::setw(static_cast<int>(width)) << "Counter" << std::right
+        << std::setw(10) << "value" << "\n";
+    for (const auto& [key, series] : series_) {
+        if (series->kind == Kind::COUNTER && series->counter->value() > 0) {
+            out << std::left << std::setw(static_cast<int>(width)) << key << std::right
+                << std::setw(10) << series->counter->value() << "\n";
+        }
+    }
+    out << std::endl;
+}
+
+} // namespace overwatch
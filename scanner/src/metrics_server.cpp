@@ -0,0 +1,118 @@
+#include "metrics_server.h"
+#include <spdlog/spdlog.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace overwatch {
+
+namespace {
+
+// Requests are tiny; anything longer is cut off and answered from what arrived
+constexpr size_t kMaxRequestSize = 8192;
+
+void sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+std::string response(const std::string& status, const std::string& content_type, const std::string& body) {
+    return "HTTP/1.1 " + status + "\r\n"
+           "Content-Type: " + content_type + "\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "Connection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, const std::string& address, int port)
+    : registry_(registry) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (port <= 0 || port > 65535 || ::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("Invalid metrics address: " + address + ":" + std::to_string(port));
+    }
+
+    fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("Could not create metrics socket: ") + std::strerror(errno));
+    }
+
+    int reuse = 1;
+    ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 16) != 0) {
+        std::string error = std::strerror(errno);
+        ::close(fd_);
+        throw std::runtime_error("Could not listen on " + address + ":" + std::to_string(port) + ": " + error);
+    }
+
+    thread_ = std::thread([this]() { serve(); });
+    spdlog::info("Serving metrics on http://{}:{}/metrics", address, port);
+}
+
+MetricsServer::~MetricsServer() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    ::close(fd_);
+}
+
+void MetricsServer::serve() {
+    while (!stop_) {
+        // Wake up regularly so the destructor never waits long
+        pollfd pfd{fd_, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 250);
+        if (ready <= 0) {
+            continue;
+        }
+
+        int client = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        handle(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::handle(int client) {
+    // A stalled client must not block the next scrape for long
+    timeval timeout{2, 0};
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.size() < kMaxRequestSize && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string line = request.substr(0, request.find("\r\n"));
+    if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+        sendAll(client, response("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_.prometheus()));
+    } else {
+        sendAll(client, response("404 Not Found", "text/plain", "Not found\n"));
+    }
+}
+
+} // namespace overwatch
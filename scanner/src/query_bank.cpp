@@ -1,9 +1,10 @@
 #include "query_bank.h"
+#include "atomic_file.h"
 #include <yaml-cpp/yaml.h>
 #include <spdlog/spdlog.h>
 #include <fstream>
 #include <algorithm>
-#include <random>
+#include <cmath>
 
 namespace overwatch {
 
@@ -30,6 +31,9 @@ void QueryBank::load(const std::string& yaml_path) {
             query.name = query_node["name"].as<std::string>();
             query.query = query_node["query"].as<std::string>();
             query.max_repos = query_node["max_repos"].as<int>();
+            if (query_node["fetch_mode"]) {
+                query.fetch_mode = query_node["fetch_mode"].as<std::string>();
+            }
 
             // Load tags
             if (query_node["tags"]) {
@@ -47,6 +51,129 @@ void QueryBank::load(const std::string& yaml_path) {
         spdlog::error("Failed to load query bank: {}", e.what());
         spdlog::warn("Starting with empty query bank");
     }
+
+    // Run state lives in its own file so the hand-edited bank isn't rewritten after every scan
+    size_t slash = yaml_path.rfind('/');
+    state_path_ = (slash == std::string::npos ? std::string() : yaml_path.substr(0, slash + 1)) + "query_state.yaml";
+    loadState();
+}
+
+void QueryBank::loadState() {
+    YAML::Node state;
+    try {
+        state = YAML::LoadFile(state_path_);
+    } catch (const YAML::BadFile&) {
+        return;  // No run recorded yet
+    } catch (const YAML::Exception& e) {
+        spdlog::warn("Ignoring unreadable query state {}: {}", state_path_, e.what());
+        return;
+    }
+
+    if (!state["queries"]) {
+        return;
+    }
+
+    for (const auto& node : state["queries"]) {
+        if (!node["id"] || !node["query"]) {
+            continue;
+        }
+
+        int id = node["id"].as<int>();
+        std::string text = node["query"].as<std::string>();
+
+        // State only applies to the query text it was recorded for
+        for (auto& query : queries_) {
+            if (query.id == id && query.query == text) {
+                query.cursor = node["cursor"] ? node["cursor"].as<std::string>() : "";
+                if (node["yield"]) {
+                    const YAML::Node& yield = node["yield"];
+                    query.yield.runs = yield["runs"].as<double>(0);
+                    query.yield.requests = yield["requests"].as<double>(0);
+                    query.yield.new_repos = yield["new_repos"].as<double>(0);
+                    query.yield.findings = yield["findings"].as<double>(0);
+                }
+            }
+        }
+    }
+}
+
+void QueryBank::saveState() {
+    if (state_path_.empty()) {
+        return;
+    }
+
+    YAML::Emitter out;
+    out << YAML::BeginMap;
+    out << YAML::Key << "queries";
+    out << YAML::Value << YAML::BeginSeq;
+
+    for (const auto& query : queries_) {
+        if (query.cursor.empty() && query.yield.runs <= 0) {
+            continue;
+        }
+
+        out << YAML::BeginMap;
+        out << YAML::Key << "id" << YAML::Value << query.id;
+        out << YAML::Key << "query" << YAML::Value << query.query;
+        if (!query.cursor.empty()) {
+            out << YAML::Key << "cursor" << YAML::Value << query.cursor;
+        }
+        if (query.yield.runs > 0) {
+            out << YAML::Key << "yield" << YAML::Value << YAML::BeginMap;
+            out << YAML::Key << "runs" << YAML::Value << query.yield.runs;
+            out << YAML::Key << "requests" << YAML::Value << query.yield.requests;
+            out << YAML::Key << "new_repos" << YAML::Value << query.yield.new_repos;
+            out << YAML::Key << "findings" << YAML::Value << query.yield.findings;
+            out << YAML::EndMap;
+        }
+        out << YAML::EndMap;
+    }
+
+    out << YAML::EndSeq;
+    out << YAML::EndMap;
+
+    // Replace atomically so an interrupted write can't lose every cursor
+    if (!writeFileAtomically(state_path_, [&out](std::ostream& file) { file << out.c_str() << "\n"; })) {
+        spdlog::warn("Failed to write query state: {}", state_path_);
+    }
+}
+
+void QueryBank::recordCursor(int id, const std::string& pushed_at) {
+    for (auto& query : queries_) {
+        if (query.id == id && pushed_at > query.cursor) {
+            spdlog::debug("Query {} cursor advanced to {}", id, pushed_at);
+            query.cursor = pushed_at;
+            saveState();
+            return;
+        }
+    }
+}
+
+void QueryBank::recordYield(int id, int new_repos, int findings, uint64_t requests) {
+    for (auto& query : queries_) {
+        if (query.id == id) {
+            QueryYield& yield = query.yield;
+            yield.runs = yield.runs * kYieldDecay + 1;
+            yield.requests = yield.requests * kYieldDecay + static_cast<double>(requests);
+            yield.new_repos = yield.new_repos * kYieldDecay + new_repos;
+            yield.findings = yield.findings * kYieldDecay + findings;
+            spdlog::debug("Query {} yield now {:.3f} over {:.1f} runs", id, yield.value(), yield.runs);
+            saveState();
+            return;
+        }
+    }
+}
+
+void QueryBank::adoptState(const QueryBank& previous) {
+    for (auto& query : queries_) {
+        for (const auto& old : previous.queries_) {
+            if (old.id == query.id && old.query == query.query) {
+                query.cursor = old.cursor;
+                query.yield = old.yield;
+                break;
+            }
+        }
+    }
 }
 
 void QueryBank::save(const std::string& yaml_path) {
@@ -63,6 +190,9 @@ void QueryBank::save(const std::string& yaml_path) {
         out << YAML::Key << "name" << YAML::Value << query.name;
         out << YAML::Key << "query" << YAML::Value << query.query;
         out << YAML::Key << "max_repos" << YAML::Value << query.max_repos;
+        if (!query.fetch_mode.empty()) {
+            out << YAML::Key << "fetch_mode" << YAML::Value << query.fetch_mode;
+        }
 
         out << YAML::Key << "tags" << YAML::Value << YAML::BeginSeq;
         for (const auto& tag : query.tags) {
@@ -120,11 +250,43 @@ Query QueryBank::getRandomQuery() const {
         throw std::runtime_error("Query bank is empty");
     }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, queries_.size() - 1);
+    std::uniform_int_distribution<size_t> dis(0, queries_.size() - 1);
+    return queries_[dis(rng_)];
+}
 
-    return queries_[dis(gen)];
+Query QueryBank::nextQuery() const {
+    if (queries_.empty()) {
+        throw std::runtime_error("Query bank is empty");
+    }
+
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    if (coin(rng_) < kExplorationFloor) {
+        return getRandomQuery();
+    }
+
+    double total_runs = 0;
+    double best_value = 0;
+    for (const auto& query : queries_) {
+        if (query.yield.runs <= 0) {
+            return query;
+        }
+        total_runs += query.yield.runs;
+        best_value = std::max(best_value, query.yield.value());
+    }
+
+    // Upper confidence bound: mean (relative to the best) plus a bonus that
+    // shrinks as a query accumulates runs
+    const Query* pick = &queries_.front();
+    double best_score = -1;
+    for (const auto& query : queries_) {
+        double mean = best_value > 0 ? query.yield.value() / best_value : 0;
+        double score = mean + std::sqrt(2 * std::log(1 + total_runs) / query.yield.runs);
+        if (score > best_score) {
+            best_score = score;
+            pick = &query;
+        }
+    }
+    return *pick;
 }
 
 std::vector<Query> QueryBank::filterByTag(const std::string& tag) const {
@@ -0,0 +1,152 @@
+#include "rate_limiter.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <thread>
+
+namespace overwatch {
+
+// Default pacing until the first response tells us the real quota:
+// authenticated core is 5000/hour, search is 30/minute, GraphQL 5000 points/hour
+RateLimiter::RateLimiter() {
+    auto now = Clock::now();
+
+    core_.capacity = 20;
+    core_.tokens = core_.capacity;
+    core_.refill_per_sec = 5000.0 / 3600.0;
+    core_.default_limit = 5000;
+    core_.last_refill = now;
+    core_.blocked_until = now;
+
+    search_.capacity = 5;
+    search_.tokens = search_.capacity;
+    search_.refill_per_sec = 30.0 / 60.0;
+    search_.default_limit = 30;
+    search_.last_refill = now;
+    search_.blocked_until = now;
+
+    graphql_.capacity = 10;
+    graphql_.tokens = graphql_.capacity;
+    graphql_.refill_per_sec = 5000.0 / 3600.0;
+    graphql_.default_limit = 5000;
+    graphql_.last_refill = now;
+    graphql_.blocked_until = now;
+}
+
+void RateLimiter::acquire(RateResource resource) {
+    while (true) {
+        Clock::duration wait;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Bucket& b = bucket(resource);
+            auto now = Clock::now();
+
+            if (now < b.blocked_until) {
+                wait = b.blocked_until - now;
+            } else {
+                refill(b, now);
+                if (b.tokens >= 1.0) {
+                    b.tokens -= 1.0;
+                    if (b.remaining > 0) {
+                        b.remaining--;
+                    }
+                    return;
+                }
+                wait = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>((1.0 - b.tokens) / b.refill_per_sec));
+            }
+        }
+
+        // Sleep in short slices so fresh headers from other threads take effect quickly
+        std::this_thread::sleep_for(std::min<Clock::duration>(wait, std::chrono::seconds(1)));
+    }
+}
+
+void RateLimiter::update(RateResource resource, const RateLimitInfo& info) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket& b = bucket(resource);
+    auto now = Clock::now();
+    refill(b, now);
+
+    if (info.remaining >= 0 && info.reset > 0) {
+        long long now_epoch = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        long long window_left = std::max(1LL, info.reset - now_epoch);
+
+        b.remaining = info.remaining;
+
+        if (info.remaining == 0) {
+            // Quota exhausted: nothing may be sent until the window resets
+            b.tokens = 0;
+            b.blocked_until = std::max(b.blocked_until, now + std::chrono::seconds(window_left));
+            spdlog::warn("Rate limit exhausted, pausing for {}s", window_left);
+        } else {
+            // Spread what is left evenly over the rest of the window
+            b.refill_per_sec = std::max(0.01, static_cast<double>(info.remaining) / window_left);
+            b.tokens = std::min(b.tokens, static_cast<double>(info.remaining));
+        }
+    }
+
+    if (info.retry_after > 0) {
+        b.blocked_until = std::max(b.blocked_until, now + std::chrono::seconds(info.retry_after));
+    }
+}
+
+void RateLimiter::backoff(RateResource resource, std::chrono::seconds delay) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Bucket& b = bucket(resource);
+    b.blocked_until = std::max(b.blocked_until, Clock::now() + delay);
+    b.tokens = 0;
+}
+
+int RateLimiter::remaining(RateResource resource) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bucket(resource).remaining;
+}
+
+double RateLimiter::headroom(RateResource resource) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Bucket& b = bucket(resource);
+    auto now = Clock::now();
+
+    if (now < b.blocked_until) {
+        return -std::chrono::duration<double>(b.blocked_until - now).count();
+    }
+
+    return b.remaining >= 0 ? b.remaining : b.default_limit;
+}
+
+bool RateLimiter::parseResource(const std::string& name, RateResource& resource) {
+    if (name == "core") {
+        resource = RateResource::CORE;
+        return true;
+    }
+    if (name == "search") {
+        resource = RateResource::SEARCH;
+        return true;
+    }
+    if (name == "graphql") {
+        resource = RateResource::GRAPHQL;
+        return true;
+    }
+    return false;
+}
+
+RateLimiter::Bucket& RateLimiter::bucket(RateResource resource) {
+    switch (resource) {
+    case RateResource::SEARCH: return search_;
+    case RateResource::GRAPHQL: return graphql_;
+    default: return core_;
+    }
+}
+
+const RateLimiter::Bucket& RateLimiter::bucket(RateResource resource) const {
+    return const_cast<RateLimiter*>(this)->bucket(resource);
+}
+
+void RateLimiter::refill(Bucket& b, Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - b.last_refill).count();
+    b.tokens = std::min(b.capacity, b.tokens + elapsed * b.refill_per_sec);
+    b.last_refill = now;
+}
+
+} // namespace overwatch
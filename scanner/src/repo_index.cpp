@@ -0,0 +1,362 @@
+#include "repo_index.h"
+#include <spdlog/spdlog.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace overwatch {
+
+namespace {
+
+const char kMagic[8] = {'O', 'W', 'R', 'I', 'D', 'X', '\0', '\0'};
+
+// splitmix64 finalizer: derives independent Bloom bits from the key hash
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Holds flock(2) with the given operation (LOCK_SH or LOCK_EX) while in scope
+class FileLock {
+public:
+    FileLock(int fd, int operation) : fd_(fd) {
+        while (::flock(fd_, operation) != 0 && errno == EINTR) {
+        }
+    }
+    ~FileLock() { ::flock(fd_, LOCK_UN); }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+} // namespace
+
+RepoIndex::RepoIndex(const std::string& path, const std::string& import_path) : path_(path) {
+    std::string lock_path = path_ + ".lock";
+    lock_fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lock_fd_ < 0) {
+        throw systemError("Failed to open", lock_path);
+    }
+
+    try {
+        // Held while opening too, so two processes never both create (and truncate) the index
+        FileLock file_lock(lock_fd_, LOCK_EX);
+        if (open()) {
+            spdlog::info("Loaded scanned repository index ({} repositories)", header_->count);
+            return;
+        }
+
+        create(path_, kMinCapacity);
+        mapFile();
+
+        if (!import_path.empty()) {
+            importList(import_path);
+        }
+    } catch (...) {
+        unmap();
+        ::close(lock_fd_);
+        throw;
+    }
+}
+
+RepoIndex::~RepoIndex() {
+    unmap();
+    ::close(lock_fd_);
+}
+
+uint64_t RepoIndex::hashKey(std::string_view owner, std::string_view repo) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto feed = [&hash](std::string_view text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    feed(owner);
+    feed("/");
+    feed(repo);
+    return hash == 0 ? 1 : hash;
+}
+
+bool RepoIndex::contains(std::string_view owner, std::string_view repo) {
+    uint64_t hash = hashKey(owner, repo);
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock file_lock(lock_fd_, LOCK_SH);
+    remapIfReplaced();
+    return containsHash(hash);
+}
+
+bool RepoIndex::insert(std::string_view owner, std::string_view repo) {
+    uint64_t hash = hashKey(owner, repo);
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock file_lock(lock_fd_, LOCK_EX);
+    remapIfReplaced();
+    return insertHash(hash);
+}
+
+size_t RepoIndex::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FileLock file_lock(lock_fd_, LOCK_SH);
+    remapIfReplaced();
+    return static_cast<size_t>(header_->count);
+}
+
+uint64_t RepoIndex::bloomWords(uint64_t capacity) {
+    // 16 bits per slot; at the 70% load limit that is ~23 bits per key
+    return capacity / 4;
+}
+
+size_t RepoIndex::fileSize(uint64_t capacity) {
+    return sizeof(Header) + static_cast<size_t>(bloomWords(capacity) + capacity) * sizeof(uint64_t);
+}
+
+bool RepoIndex::open() {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        if (errno != ENOENT) {
+            throw systemError("Failed to open", path_);
+        }
+        return false;
+    }
+
+    // Validate the header before trusting any sizes from it
+    Header header;
+    struct stat st;
+    bool valid = ::fstat(fd_, &st) == 0 &&
+                 ::pread(fd_, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header.version == kVersion &&
+                 header.bloom_hashes >= 1 && header.bloom_hashes <= kBloomHashes &&
+                 header.capacity >= kMinCapacity &&
+                 (header.capacity & (header.capacity - 1)) == 0 &&
+                 header.bloom_words == bloomWords(header.capacity) &&
+                 static_cast<size_t>(st.st_size) == fileSize(header.capacity);
+
+    if (!valid) {
+        spdlog::warn("Scanned repository index {} is corrupt or outdated, starting a new one", path_);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    mapFile();
+    return true;
+}
+
+void RepoIndex::create(const std::string& path, uint64_t capacity) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw systemError("Failed to create", path);
+    }
+
+    // Zero-filled by ftruncate: an empty Bloom filter and all-empty slots
+    if (::ftruncate(fd, static_cast<off_t>(fileSize(capacity))) != 0) {
+        ::close(fd);
+        throw systemError("Failed to size", path);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.bloom_hashes = kBloomHashes;
+    header.capacity = capacity;
+    header.bloom_words = bloomWords(capacity);
+
+    if (::pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        ::close(fd);
+        throw systemError("Failed to write", path);
+    }
+
+    if (path == path_) {
+        fd_ = fd;
+    } else {
+        ::close(fd);
+    }
+}
+
+void RepoIndex::mapFile() {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        throw systemError("Failed to stat", path_);
+    }
+
+    map_size_ = static_cast<size_t>(st.st_size);
+    map_ = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        throw systemError("Failed to map", path_);
+    }
+
+    header_ = static_cast<Header*>(map_);
+    bloom_ = reinterpret_cast<uint64_t*>(static_cast<char*>(map_) + sizeof(Header));
+    slots_ = bloom_ + header_->bloom_words;
+}
+
+void RepoIndex::unmap() {
+    if (map_ != nullptr) {
+        ::msync(map_, map_size_, MS_ASYNC);
+        ::munmap(map_, map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    bloom_ = nullptr;
+    slots_ = nullptr;
+}
+
+void RepoIndex::remapIfReplaced() {
+    struct stat on_disk;
+    struct stat mapped;
+    if (::stat(path_.c_str(), &on_disk) != 0 || ::fstat(fd_, &mapped) != 0 ||
+        (on_disk.st_dev == mapped.st_dev && on_disk.st_ino == mapped.st_ino)) {
+        return;
+    }
+
+    // Another process grew the table; what it renamed into place holds every key
+    unmap();
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw systemError("Failed to open", path_);
+    }
+    mapFile();
+    spdlog::debug("Remapped scanned repository index grown by another process ({} slots)", header_->capacity);
+}
+
+void RepoIndex::importList(const std::string& import_path) {
+    std::ifstream infile(import_path);
+    if (!infile) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(infile, line)) {
+        size_t slash = line.find('/');
+        if (slash == std::string::npos) {
+            continue;
+        }
+        std::string_view id(line);
+        insertHash(hashKey(id.substr(0, slash), id.substr(slash + 1)));
+    }
+
+    spdlog::info("Imported {} previously scanned repositories from {}", header_->count, import_path);
+}
+
+void RepoIndex::grow() {
+    // Runs under the exclusive lock, so no other process inserts into the old file meanwhile.
+    // Collect live keys, build a table twice the size beside the old one, then rename it in
+    std::vector<uint64_t> keys;
+    keys.reserve(static_cast<size_t>(header_->count));
+    for (uint64_t i = 0; i < header_->capacity; i++) {
+        if (slots_[i] != 0) {
+            keys.push_back(slots_[i]);
+        }
+    }
+
+    uint64_t capacity = header_->capacity * 2;
+    std::string tmp_path = path_ + ".tmp";
+    create(tmp_path, capacity);
+
+    unmap();
+    fd_ = ::open(tmp_path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        throw systemError("Failed to open", tmp_path);
+    }
+    mapFile();
+
+    for (uint64_t key : keys) {
+        insertHash(key);
+    }
+
+    // Only replace the old index once the new one holds every key
+    ::msync(map_, map_size_, MS_SYNC);
+    if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        throw systemError("Failed to replace", path_);
+    }
+
+    spdlog::debug("Grew scanned repository index to {} slots", capacity);
+}
+
+bool RepoIndex::containsHash(uint64_t hash) const {
+    if (!bloomTest(hash)) {
+        return false;
+    }
+
+    uint64_t mask = header_->capacity - 1;
+    for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+        if (slots_[i] == hash) {
+            return true;
+        }
+        if (slots_[i] == 0) {
+            return false;
+        }
+    }
+}
+
+bool RepoIndex::insertHash(uint64_t hash) {
+    // Keep probe sequences short: at most 70% of slots in use
+    if ((header_->count + 1) * 10 > header_->capacity * 7) {
+        grow();
+    }
+
+    uint64_t mask = header_->capacity - 1;
+    uint64_t i = hash & mask;
+    while (slots_[i] != 0) {
+        if (slots_[i] == hash) {
+            return false;
+        }
+        i = (i + 1) & mask;
+    }
+
+    slots_[i] = hash;
+    header_->count++;
+    bloomAdd(hash);
+    return true;
+}
+
+void RepoIndex::bloomAdd(uint64_t hash) {
+    uint64_t a = mix(hash);
+    uint64_t* block = bloom_ + (a & (header_->bloom_words / kBloomBlockWords - 1)) * kBloomBlockWords;
+    uint64_t b = mix(a);
+    for (uint32_t k = 0; k < header_->bloom_hashes; k++) {
+        unsigned bit = static_cast<unsigned>((b >> (k * 9)) & 511);
+        block[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+bool RepoIndex::bloomTest(uint64_t hash) const {
+    uint64_t a = mix(hash);
+    const uint64_t* block = bloom_ + (a & (header_->bloom_words / kBloomBlockWords - 1)) * kBloomBlockWords;
+    uint64_t b = mix(a);
+    for (uint32_t k = 0; k < header_->bloom_hashes; k++) {
+        unsigned bit = static_cast<unsigned>((b >> (k * 9)) & 511);
+        if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace overwatch
@@ -0,0 +1,37 @@
+#include "scan_context.h"
+#include <algorithm>
+
+namespace overwatch {
+
+ScanContext::ScanContext(size_t initial_bytes)
+    : block_(std::make_unique<std::byte[]>(initial_bytes)), block_bytes_(initial_bytes) {
+    arena_.emplace(block_.get(), block_bytes_, &overflow_);
+}
+
+void ScanContext::reset() {
+    arena_->release();
+
+    if (overflow_.bytes > 0 && block_bytes_ < kMaxRetainedBytes) {
+        // The arena is rebuilt over the larger block; nothing points into the old one after release()
+        block_bytes_ = std::min(kMaxRetainedBytes, block_bytes_ + overflow_.bytes);
+        arena_.reset();
+        block_ = std::make_unique<std::byte[]>(block_bytes_);
+        arena_.emplace(block_.get(), block_bytes_, &overflow_);
+    }
+    overflow_.bytes = 0;
+}
+
+void* ScanContext::Overflow::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void ScanContext::Overflow::do_deallocate(void* p, size_t size, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+}
+
+bool ScanContext::Overflow::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+} // namespace overwatch
@@ -1,167 +1,561 @@
 #include "scanner.h"
-#include <nlohmann/json.hpp>
+#include "bounded_queue.h"
+#include "metrics.h"
 #include <spdlog/spdlog.h>
 #include <fstream>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
 #include <thread>
+#include <unordered_map>
 
 namespace overwatch {
 
-Scanner::Scanner(GitHubClient& client, SecretDetector& detector, const std::string& output_file)
-    : client_(client), detector_(detector), output_file_(output_file),
-      scanned_repos_file_("data/scanned_repos.txt") {
-    loadScannedRepos();
+namespace {
+
+// Branch the tree and files are read from
+std::string defaultRef(const Repository& repo) {
+    return repo.default_branch.empty() ? "HEAD" : repo.default_branch;
 }
 
-void Scanner::run(const std::string& search_query, int max_repos) {
-    spdlog::info("Starting scan with query: {}", search_query);
-    if (max_repos == 0) {
-        spdlog::info("Maximum repositories to scan: unlimited");
-    } else {
-        spdlog::info("Maximum repositories to scan: {}", max_repos);
+// Patterns target files by base name
+std::string_view basename(const std::string& path) {
+    std::string_view filename = path;
+    size_t slash = filename.rfind('/');
+    if (slash != std::string_view::npos) {
+        filename.remove_prefix(slash + 1);
     }
+    return filename;
+}
 
-    // Search for repositories
-    auto repos = client_.searchRepositories(search_query, max_repos);
+} // namespace
 
-    if (repos.empty()) {
-        spdlog::warn("No repositories found matching query");
-        return;
+Scanner::Scanner(RepoSource& source, SecretDetector& detector, RepoIndex& scanned,
+                 FindingsSink& sink, const ScanConfig& config, BlobCache* blob_cache)
+    : source_(source), detector_(detector), scanned_(scanned), sink_(sink), config_(config),
+      blob_cache_(blob_cache) {
+}
+
+ScanStats Scanner::run(const std::string& search_query, int max_repos, const SearchOptions& search_options) {
+    ScanJob job;
+    job.query = search_query;
+    job.max_repos = max_repos;
+    job.options = search_options;
+    return runBatch({job}, 1)[0];
+}
+
+std::vector<ScanStats> Scanner::runBatch(const std::vector<ScanJob>& jobs, int parallel_searches) {
+    for (const auto& job : jobs) {
+        spdlog::info("Starting scan with query: {} (max {})", job.query,
+                     job.max_repos == 0 ? std::string("unlimited") : std::to_string(job.max_repos));
     }
 
-    spdlog::info("Found {} repositories to scan", repos.size());
+    BoundedQueue<Repository> repo_queue(config_.queue_capacity);
+    BoundedQueue<Finding> finding_queue(config_.queue_capacity * 4);
 
-    // Scan each repository
-    int scanned = 0;
-    int skipped = 0;
-    for (const auto& repo : repos) {
-        // Skip archived repositories
-        if (repo.archived) {
-            spdlog::debug("Skipping archived repo: {}/{}", repo.owner, repo.name);
-            skipped++;
-            continue;
+    // found/skipped/duplicates are written by the job's search thread only; so is
+    // newest_pushed_at until the end, when it covers skipped results only
+    std::vector<ScanStats> stats(jobs.size());
+    std::vector<std::atomic<int>> scanned(jobs.size());
+    std::vector<std::atomic<int>> findings(jobs.size());
+
+    // Repositories queued so far, and by which job: a repository two searches
+    // return is queued once, before anything is fetched for it
+    std::mutex claimed_mutex;
+    std::unordered_map<std::string, size_t> claimed;
+    std::unordered_multimap<std::string, size_t> also_wanted;   // Other jobs that returned a claimed repository
+
+    // Guarded by claimed_mutex. A job's cursor may only pass repositories that
+    // were scanned: pushed_at of the ones still queued or in a worker, and the
+    // newest of the ones finished
+    std::vector<std::multiset<std::string>> unfinished(jobs.size());
+    std::vector<std::string> newest_finished(jobs.size());
+
+    auto stopping = [this]() {
+        return config_.stop != nullptr && config_.stop->load();
+    };
+
+    // Search stage: each search thread takes the next job and feeds its results into the queue
+    std::atomic<size_t> next_job{0};
+    auto search = [&]() {
+        for (size_t j = next_job++; j < jobs.size() && !stopping(); j = next_job++) {
+            const ScanJob& job = jobs[j];
+            ScanStats& job_stats = stats[j];
+
+            try {
+                // Repositories are queued page by page, so scanning starts after the first page
+                source_.searchRepositoriesPaged(job.query, job.max_repos, job.options, [&](SearchPage& page) {
+                    job_stats.found += static_cast<int>(page.repositories.size());
+                    spdlog::info("Queueing {} repositories from search page {}", page.repositories.size(), page.page);
+
+                    for (auto& repo : page.repositories) {
+                        if (stopping()) {
+                            return false;
+                        }
+
+                        // Skip archived repositories
+                        // (ISO 8601 timestamps in one format compare correctly as strings)
+                        if (repo.archived) {
+                            spdlog::debug("Skipping archived repo: {}/{}", repo.owner, repo.name);
+                            job_stats.skipped++;
+                            job_stats.newest_pushed_at = std::max(job_stats.newest_pushed_at, repo.pushed_at);
+                            continue;
+                        }
+
+                        // Skip already scanned repositories
+                        if (scanned_.contains(repo.owner, repo.name)) {
+                            spdlog::debug("Skipping already scanned repo: {}/{}", repo.owner, repo.name);
+                            job_stats.skipped++;
+                            job_stats.newest_pushed_at = std::max(job_stats.newest_pushed_at, repo.pushed_at);
+                            continue;
+                        }
+
+                        {
+                            // Unfinished until a worker is done with it, even if the push below fails
+                            std::lock_guard<std::mutex> lock(claimed_mutex);
+                            std::string key = repo.owner + "/" + repo.name;
+                            unfinished[j].insert(repo.pushed_at);
+                            if (!claimed.emplace(key, j).second) {
+                                spdlog::debug("Skipping repo another query queued: {}/{}", repo.owner, repo.name);
+                                also_wanted.emplace(key, j);
+                                job_stats.duplicates++;
+                                continue;
+                            }
+                        }
+
+                        if (!repo_queue.push(std::move(repo))) {
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+            } catch (const std::exception& e) {
+                spdlog::error("Search failed for {}: {}", job.query, e.what());
+            }
+        }
+    };
+
+    std::vector<std::thread> searchers;
+    for (int i = 0; i < std::clamp(parallel_searches, 1, static_cast<int>(std::max<size_t>(1, jobs.size()))); i++) {
+        searchers.emplace_back(search);
+    }
+
+    // Credit a scanned repository to the job that queued it
+    auto owner = [&](const std::string& repo_owner, const std::string& repo_name) {
+        std::lock_guard<std::mutex> lock(claimed_mutex);
+        return claimed.at(repo_owner + "/" + repo_name);
+    };
+
+    // A worker is done with a repository: every job that returned it may move its cursor past it
+    auto finish = [&](const Repository& repo) {
+        std::lock_guard<std::mutex> lock(claimed_mutex);
+        std::string key = repo.owner + "/" + repo.name;
+        auto release = [&](size_t j) {
+            unfinished[j].erase(unfinished[j].find(repo.pushed_at));
+            newest_finished[j] = std::max(newest_finished[j], repo.pushed_at);
+        };
+        release(claimed.at(key));
+        auto [first, last] = also_wanted.equal_range(key);
+        for (auto it = first; it != last; ++it) {
+            release(it->second);
         }
+    };
 
-        // Skip already scanned repositories
-        if (isAlreadyScanned(repo.owner, repo.name)) {
-            spdlog::debug("Skipping already scanned repo: {}/{}", repo.owner, repo.name);
-            skipped++;
+    // Scan stage: each worker scans one repository at a time
+    Histogram& repo_time = MetricsRegistry::global().histogram(
+        "overwatch_repository_scan_seconds", {}, "Time to list, fetch and scan one repository");
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::max(1, config_.scan_workers); i++) {
+        workers.emplace_back([&]() {
+            // GraphQL mode takes several queued repositories at once and fetches their files together
+            bool batched = config_.fetch_mode == FetchMode::GRAPHQL;
+            size_t batch_size = batched ? static_cast<size_t>(std::max(1, config_.graphql_batch_repos)) : 1;
+
+            // Detector scratch for every file of a repository, released before the next one
+            ScanContext context;
+
+            while (true) {
+                std::vector<Repository> batch = repo_queue.popBatch(batch_size);
+                if (batch.empty()) {
+                    break;
+                }
+                if (stopping()) {
+                    repo_queue.close();  // Unblocks a search waiting for room; the batch stays unfinished
+                    break;
+                }
+
+                for (const auto& repo : batch) {
+                    spdlog::info("Scanning {}/{} ...", repo.owner, repo.name);
+                }
+
+                Stopwatch watch;
+                try {
+                    for (auto& finding : batched ? scanBatch(batch, context) : scanRepository(batch[0], context)) {
+                        findings[owner(finding.owner, finding.repo)]++;
+                        finding_queue.push(std::move(finding));
+                    }
+                } catch (const std::exception& e) {
+                    spdlog::error("Failed to scan {}/{}{}: {}", batch[0].owner, batch[0].name,
+                                  batch.size() > 1 ? " and " + std::to_string(batch.size() - 1) + " more" : "",
+                                  e.what());
+                }
+                context.reset();
+
+                // Repositories fetched together share the batch's time evenly
+                uint64_t per_repo = watch.elapsed() / batch.size();
+                for (const auto& repo : batch) {
+                    repo_time.record(per_repo);
+                    scanned_.insert(repo.owner, repo.name);
+                    scanned[owner(repo.owner, repo.name)]++;
+                    finish(repo);
+                }
+            }
+        });
+    }
+
+    // Write stage: a single thread feeds the findings sink
+    std::thread writer([&]() {
+        while (auto finding = finding_queue.pop()) {
+            if (!sink_.write(*finding)) {
+                spdlog::info("Already reported: {}/{}/{} line {} - {}",
+                             finding->owner, finding->repo, finding->file,
+                             finding->match.line_number, finding->secret_type);
+                continue;
+            }
+            spdlog::info("Wrote finding: {}/{}/{} line {} - {}",
+                        finding->owner, finding->repo, finding->file,
+                        finding->match.line_number, finding->secret_type);
+        }
+    });
+
+    for (auto& searcher : searchers) {
+        searcher.join();
+    }
+    repo_queue.close();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    finding_queue.close();
+    writer.join();
+    sink_.flush();
+
+    for (size_t j = 0; j < jobs.size(); j++) {
+        stats[j].scanned = scanned[j];
+        stats[j].findings = findings[j];
+
+        // A drain leaves queued repositories unscanned; an inclusive pushed:>= search
+        // from the oldest of them picks them up again
+        std::string& cursor = stats[j].newest_pushed_at;
+        cursor = std::max(cursor, newest_finished[j]);
+        if (!unfinished[j].empty()) {
+            cursor = std::min(cursor, *unfinished[j].begin());
+            spdlog::info("{} queued repositories left unscanned{}, cursor held at {}", unfinished[j].size(),
+                         jobs.size() > 1 ? " for " + jobs[j].query : "", cursor.empty() ? "(none)" : cursor);
+        }
+        const ScanStats& job_stats = stats[j];
+        std::string which = jobs.size() > 1 ? ": " + jobs[j].query : "";
+        if (job_stats.found == 0) {
+            spdlog::warn("No repositories found matching query{}", which);
             continue;
         }
 
-        spdlog::info("Scanning {}/{} ...", repo.owner, repo.name);
-        scanRepository(repo);
-        saveScannedRepo(repo.owner, repo.name);
-        scanned++;
+        if (job_stats.skipped > 0 || job_stats.duplicates > 0) {
+            spdlog::info("Skipped {} repositories (archived or already scanned) and {} queued by another query",
+                         job_stats.skipped, job_stats.duplicates);
+        }
+        spdlog::info("Scan complete! Scanned {} new repositories{}", job_stats.scanned, which);
+    }
+    return stats;
+}
+
+FetchMode Scanner::parseFetchMode(const std::string& name) {
+    if (name == "auto") return FetchMode::AUTO;
+    if (name == "contents") return FetchMode::CONTENTS;
+    if (name == "tarball") return FetchMode::TARBALL;
+    if (name == "graphql") return FetchMode::GRAPHQL;
+    throw std::runtime_error("Unknown fetch mode: " + name + " (expected auto, contents, tarball or graphql)");
+}
+
+std::vector<Finding> Scanner::scanRepository(const Repository& repo, ScanContext& context) {
+    std::vector<Finding> findings;
+    bool tarball_allowed = false;
+    std::vector<TreeEntry> files = candidateFiles(repo, tarball_allowed);
+    scanFiles(repo, defaultRef(repo), files, tarball_allowed, context, findings);
+    return findings;
+}
 
-        // Add small delay to avoid hitting rate limits (0.5 seconds)
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+std::vector<Finding> Scanner::scanBatch(const std::vector<Repository>& repos, ScanContext& context) {
+    std::vector<Finding> findings;
+
+    // Files still to download across every repository of the batch
+    std::vector<FileRequest> requests;
+    std::vector<std::pair<size_t, TreeEntry>> pending;  // Repository index, file
+
+    for (size_t r = 0; r < repos.size(); r++) {
+        const Repository& repo = repos[r];
+        bool tarball_allowed = false;
+        for (auto& file : candidateFiles(repo, tarball_allowed)) {
+            if (reportCached(repo, file, findings)) {
+                continue;
+            }
+            requests.push_back({repo.owner, repo.name, defaultRef(repo), file.path});
+            pending.emplace_back(r, std::move(file));
+        }
     }
 
-    if (skipped > 0) {
-        spdlog::info("Skipped {} repositories (archived or already scanned)", skipped);
+    spdlog::debug("Fetching {} files of {} repositories in batched queries", requests.size(), repos.size());
+    auto contents = source_.batchGetFiles(requests, config_.fetch_concurrency);
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        if (contents[i]) {
+            const auto& [r, file] = pending[i];
+            scanFetched(repos[r], file.path, *contents[i], !file.sha.empty(), context, findings);
+        }
     }
-    spdlog::info("Scan complete! Scanned {} new repositories", scanned);
+
+    return findings;
 }
 
-void Scanner::scanRepository(const Repository& repo) {
-    // Try to fetch each suspicious file
-    for (const auto& filename : suspicious_files_) {
+std::vector<TreeEntry> Scanner::candidateFiles(const Repository& repo, bool& tarball_allowed) {
+    if (config_.use_tree) {
         try {
-            spdlog::debug("Checking for file: {}", filename);
-
-            // Try to get file content
-            std::string content = client_.getFileContent(repo.owner, repo.name, filename);
+            RepositoryTree tree = source_.getTree(repo.owner, repo.name, defaultRef(repo), true);
 
-            spdlog::info("Found file: {} ({} bytes)", filename, content.size());
+            std::vector<TreeEntry> files = selectTreeCandidates(tree);
 
-            // Scan content for secrets
-            auto matches = detector_.scanContent(content, filename);
+            // A truncated listing may be missing root files - probe those blindly as well
+            if (tree.truncated) {
+                auto probes = probeEntries(files);
+                files.insert(files.end(), probes.begin(), probes.end());
+            }
 
-            if (!matches.empty()) {
-                spdlog::warn("Found {} potential secrets in {}/{}/{}",
-                           matches.size(), repo.owner, repo.name, filename);
+            spdlog::debug("Tree for {}/{} has {} candidate files", repo.owner, repo.name, files.size());
 
-                // Write each finding to output file
-                for (const auto& match : matches) {
-                    writeFinding(repo.owner, repo.name, filename, match);
+            // The archive holds every file, so only download it for repositories of sensible size
+            tarball_allowed = config_.fetch_mode == FetchMode::TARBALL;
+            if (config_.fetch_mode == FetchMode::AUTO && !tree.truncated) {
+                long total = 0;
+                for (const auto& entry : tree.entries) {
+                    total += entry.type == "blob" ? entry.size : 0;
                 }
+                tarball_allowed = total <= config_.tarball_max_bytes;
             }
 
+            return files;
+
         } catch (const std::exception& e) {
-            // File doesn't exist or couldn't be fetched - that's OK, continue
-            spdlog::debug("Could not fetch {}: {}", filename, e.what());
+            spdlog::debug("Tree listing failed for {}/{}, probing known files: {}",
+                        repo.owner, repo.name, e.what());
         }
     }
+
+    // Fall back to probing each suspicious file at the repository root
+    tarball_allowed = config_.fetch_mode == FetchMode::TARBALL;
+    return probeEntries();
 }
 
-void Scanner::writeFinding(const std::string& owner, const std::string& repo,
-                          const std::string& file, const Match& match) {
-    // Get current timestamp
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time_t), "%Y-%m-%dT%H:%M:%SZ");
+std::vector<TreeEntry> Scanner::probeEntries(const std::vector<TreeEntry>& known) const {
+    // Root files guessed by name; their SHA is only learned once fetched
+    std::vector<TreeEntry> probes;
+    for (const auto& filename : suspicious_files_) {
+        bool listed = std::any_of(known.begin(), known.end(),
+                                  [&filename](const TreeEntry& entry) { return entry.path == filename; });
+        if (!listed) {
+            probes.push_back({filename, "", "blob", 0});
+        }
+    }
+    return probes;
+}
 
-    // Build JSON object
-    nlohmann::json finding = {
-        {"owner", owner},
-        {"repo", repo},
-        {"file", file},
-        {"line", match.line_number},
-        {"secret_type", match.pattern_name},
-        {"matched_text", match.matched_text},
-        {"timestamp", ss.str()}
-    };
+std::vector<TreeEntry> Scanner::selectTreeCandidates(const RepositoryTree& tree) {
+    std::vector<TreeEntry> paths;
 
-    // Append to JSONL file
-    std::ofstream outfile(output_file_, std::ios::app);
-    if (!outfile) {
-        spdlog::error("Failed to open output file: {}", output_file_);
-        return;
-    }
+    for (const auto& entry : tree.entries) {
+        if (entry.type != "blob" || entry.size > kMaxBlobSize) {
+            continue;
+        }
 
-    outfile << finding.dump() << "\n";
-    outfile.close();
+        // Skip vendored/dependency directories
+        bool excluded = false;
+        size_t start = 0;
+        size_t slash;
+        while ((slash = entry.path.find('/', start)) != std::string::npos) {
+            if (excluded_dirs_.count(entry.path.substr(start, slash - start))) {
+                excluded = true;
+                break;
+            }
+            start = slash + 1;
+        }
+        if (excluded) {
+            continue;
+        }
+
+        // Match on the base name so nested files (e.g. backend/.env) are found too
+        std::string basename = entry.path.substr(start);
+        bool suspicious = std::find(suspicious_files_.begin(), suspicious_files_.end(), basename)
+                          != suspicious_files_.end();
+
+        if (suspicious || detector_.isTargetedFile(basename)) {
+            paths.push_back(entry);
+        }
+
+        if (static_cast<int>(paths.size()) >= config_.max_tree_files) {
+            spdlog::debug("Reached {} candidate files, ignoring the rest of the tree", config_.max_tree_files);
+            break;
+        }
+    }
 
-    spdlog::info("Wrote finding: {}/{}/{} line {} - {}",
-                owner, repo, file, match.line_number, match.pattern_name);
+    return paths;
 }
 
-void Scanner::loadScannedRepos() {
-    std::ifstream infile(scanned_repos_file_);
-    if (!infile) {
-        spdlog::debug("No scanned repos file found, starting fresh");
-        return;
+void Scanner::scanFiles(const Repository& repo, const std::string& ref, const std::vector<TreeEntry>& files,
+                        bool tarball_allowed, ScanContext& context, std::vector<Finding>& findings) {
+    // Blobs already scanned (same SHA, same patterns) skip the download entirely
+    std::vector<TreeEntry> pending;
+    for (const auto& file : files) {
+        if (!reportCached(repo, file, findings)) {
+            pending.push_back(file);
+        }
+    }
+
+    // Many files to fetch: one archive download instead of a request per file
+    bool use_tarball = tarball_allowed && !pending.empty() &&
+                       (config_.fetch_mode == FetchMode::TARBALL ||
+                        static_cast<int>(pending.size()) >= config_.tarball_min_files);
+    if (use_tarball) {
+        std::unordered_map<std::string, size_t> wanted;
+        for (size_t i = 0; i < pending.size(); i++) {
+            wanted.emplace(pending[i].path, i);
+        }
+        std::vector<bool> seen(pending.size(), false);
+
+        TarballReader reader(
+            [&wanted](const std::string& path, size_t) { return wanted.count(path) > 0; },
+            [&](const std::string& path, std::string&& content) {
+                size_t i = wanted[path];
+                if (!seen[i]) {
+                    seen[i] = true;
+                    spdlog::info("Found file: {} ({} bytes)", path, content.size());
+                    scanBlob(repo, path, pending[i].sha, content, context, findings);
+                }
+                return true;
+            },
+            static_cast<size_t>(kMaxBlobSize));
+
+        spdlog::debug("Fetching {} files of {}/{} as a tarball", pending.size(), repo.owner, repo.name);
+        if (source_.streamTarball(repo.owner, repo.name, ref, reader)) {
+            return;  // Files missing from the archive don't exist
+        }
+
+        // Fetch whatever the archive didn't deliver one by one
+        std::vector<TreeEntry> rest;
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (!seen[i]) {
+                rest.push_back(std::move(pending[i]));
+            }
+        }
+        pending = std::move(rest);
+        spdlog::debug("Tarball unavailable for {}/{}, fetching {} files individually",
+                      repo.owner, repo.name, pending.size());
+    }
+
+    std::vector<std::string> paths;
+    std::vector<bool> checked;  // Cache already consulted with the tree's SHA
+    for (const auto& file : pending) {
+        paths.push_back(file.path);
+        checked.push_back(!file.sha.empty());
     }
 
-    std::string line;
-    while (std::getline(infile, line)) {
-        if (!line.empty()) {
-            scanned_repos_.insert(line);
+    // Fetch the rest concurrently; results come back in paths order
+    auto contents = source_.getFileContents(repo.owner, repo.name, paths, config_.fetch_concurrency);
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        // File doesn't exist or couldn't be fetched - that's OK, continue
+        if (contents[i]) {
+            scanFetched(repo, paths[i], *contents[i], checked[i], context, findings);
         }
     }
-    infile.close();
-    spdlog::info("Loaded {} previously scanned repositories", scanned_repos_.size());
 }
 
-void Scanner::saveScannedRepo(const std::string& owner, const std::string& repo) {
-    std::string repo_id = owner + "/" + repo;
-    scanned_repos_.insert(repo_id);
+bool Scanner::reportCached(const Repository& repo, const TreeEntry& file, std::vector<Finding>& findings) {
+    if (!blob_cache_ || file.sha.empty()) {
+        return false;
+    }
 
-    // Append to file
-    std::ofstream outfile(scanned_repos_file_, std::ios::app);
-    if (outfile) {
-        outfile << repo_id << "\n";
-        outfile.close();
+    auto cached = blob_cache_->lookup(file.sha, detector_.patternProfile(basename(file.path)));
+    if (!cached) {
+        return false;
     }
+
+    spdlog::debug("Blob cache hit: {} ({})", file.path, file.sha);
+    report(repo, file.path, std::move(*cached), findings);
+    return true;
 }
 
-bool Scanner::isAlreadyScanned(const std::string& owner, const std::string& repo) {
-    std::string repo_id = owner + "/" + repo;
-    return scanned_repos_.find(repo_id) != scanned_repos_.end();
+void Scanner::scanFetched(const Repository& repo, const std::string& path, const FileContent& file,
+                          bool checked, ScanContext& context, std::vector<Finding>& findings) {
+    spdlog::info("Found file: {} ({} bytes)", path, file.content.size());
+
+    // Probed files only learn their SHA now; a known blob still skips the scan
+    if (blob_cache_ && !checked && !file.sha.empty()) {
+        if (auto cached = blob_cache_->lookup(file.sha, detector_.patternProfile(basename(path)))) {
+            report(repo, path, std::move(*cached), findings);
+            return;
+        }
+    }
+
+    // Scan content for secrets
+    scanBlob(repo, path, file.sha, file.content, context, findings);
 }
 
-} 
+void Scanner::scanBlob(const Repository& repo, const std::string& path, const std::string& sha,
+                       const std::string& content, ScanContext& context, std::vector<Finding>& findings) {
+    std::string_view filename = basename(path);
+    auto matches = detector_.scanContent(content, filename, &context);
+    if (blob_cache_ && !sha.empty()) {
+        blob_cache_->store(sha, detector_.patternProfile(filename), matches);
+    }
+    report(repo, path, std::move(matches), findings);
+}
+
+void Scanner::report(const Repository& repo, const std::string& path, std::vector<Match> matches,
+                     std::vector<Finding>& findings) {
+    if (!config_.keep_low_entropy) {
+        size_t before = matches.size();
+        matches.erase(std::remove_if(matches.begin(), matches.end(),
+                                     [](const Match& match) { return match.low_entropy; }),
+                      matches.end());
+        if (matches.size() < before) {
+            spdlog::info("Dropped {} low-entropy matches in {}/{}/{}",
+                         before - matches.size(), repo.owner, repo.name, path);
+        }
+    }
+
+    if (matches.empty()) {
+        return;
+    }
+
+    // Kept low-entropy matches are down-ranked: still written, flagged, but not in the warning count
+    size_t low = static_cast<size_t>(std::count_if(matches.begin(), matches.end(),
+                                                   [](const Match& match) { return match.low_entropy; }));
+    if (low < matches.size()) {
+        spdlog::warn("Found {} potential secrets in {}/{}/{}",
+                   matches.size() - low, repo.owner, repo.name, path);
+    }
+    if (low > 0) {
+        spdlog::info("Found {} low-entropy matches in {}/{}/{}", low, repo.owner, repo.name, path);
+    }
+
+    // Hand each finding to the writer stage; names are only looked up for matches that are reported
+    const auto& patterns = detector_.patterns();
+    for (auto& match : matches) {
+        if (match.pattern_index >= patterns.size()) {
+            continue;  // Only from a corrupt cache entry
+        }
+        findings.push_back({repo.owner, repo.name, path, patterns[match.pattern_index].name, std::move(match)});
+    }
+}
+
+}
@@ -1,12 +1,13 @@
 #include "secret_detector.h"
+#include "metrics.h"
 #include <yaml-cpp/yaml.h>
 #include <spdlog/spdlog.h>
-#include <sstream>
 #include <algorithm>
 
 namespace overwatch {
 
-SecretDetector::SecretDetector() {
+SecretDetector::SecretDetector(const std::string& engine)
+    : engine_(MatcherEngine::create(engine)) {
 }
 
 void SecretDetector::loadPatterns(const std::string& yaml_path) {
@@ -21,9 +22,7 @@ void SecretDetector::loadPatterns(const std::string& yaml_path) {
     for (const auto& pattern_node : config["patterns"]) {
         Pattern pattern;
         pattern.name = pattern_node["name"].as<std::string>();
-
-        std::string regex_str = pattern_node["regex"].as<std::string>();
-        pattern.regex = std::regex(regex_str, std::regex::icase);
+        pattern.regex = pattern_node["regex"].as<std::string>();
 
         if (pattern_node["files"]) {
             for (const auto& file : pattern_node["files"]) {
@@ -31,67 +30,346 @@ void SecretDetector::loadPatterns(const std::string& yaml_path) {
             }
         }
 
+        // Required literal: explicit prefilter: key, or extracted from the regex
+        if (pattern_node["prefilter"]) {
+            pattern.prefilter = pattern_node["prefilter"].as<std::string>();
+            if (!pattern.prefilter.empty() && pattern.prefilter.size() < LiteralPrefilter::kMinLiteralLength) {
+                spdlog::warn("Prefilter '{}' for {} is too short, ignoring it", pattern.prefilter, pattern.name);
+                pattern.prefilter.clear();
+            }
+        } else {
+            pattern.prefilter = LiteralPrefilter::extractLiteral(pattern.regex);
+        }
+
+        // Placeholders ("xxxx", "your-key-here") match loose patterns but carry little entropy
+        if (pattern_node["min_entropy"]) {
+            pattern.min_entropy = pattern_node["min_entropy"].as<float>();
+        }
+
+        if (!pattern.prefilter.empty()) {
+            pattern.literal_id = static_cast<int>(prefilter_.add(pattern.prefilter));
+            spdlog::debug("Pattern {} prefiltered on '{}'", pattern.name, pattern.prefilter);
+        }
+
+        dispatch_.add(patterns_.size(), pattern.files);
+        MetricsRegistry& registry = MetricsRegistry::global();
+        MetricLabels labels = {{"pattern", pattern.name}};
+        pattern_metrics_.push_back({
+            &registry.histogram("overwatch_pattern_seconds", labels,
+                                "Time per file spent locating matches of one pattern"),
+            &registry.counter("overwatch_pattern_matches_total", labels, "Matches found by one pattern"),
+            &registry.counter("overwatch_pattern_over_budget_total", labels,
+                              "Files one pattern stopped on early after exceeding its time budget"),
+            &registry.counter("overwatch_pattern_low_entropy_total", labels,
+                              "Matches of one pattern flagged for scoring under its min_entropy")
+        });
         patterns_.push_back(pattern);
     }
 
-    spdlog::info("Loaded {} patterns", patterns_.size());
-}
+    // Compile every pattern into one engine so each file is matched in a single pass
+    std::vector<std::string> regexes;
+    regexes.reserve(patterns_.size());
+    for (const auto& pattern : patterns_) {
+        regexes.push_back(pattern.regex);
+    }
+    engine_->compile(regexes);
 
-std::vector<Match> SecretDetector::scanContent(const std::string& content, const std::string& filename) {
-    std::vector<Match> matches;
+    // Budgets can't interrupt a backtracking search, so long lines go to RE2 if it can take the set
+    long_line_engine_.reset();
+    auto engines = MatcherEngine::available();
+    if (!engine_->linearTime() && std::find(engines.begin(), engines.end(), "re2") != engines.end()) {
+        try {
+            auto re2 = MatcherEngine::create("re2");
+            re2->compile(regexes);
+            long_line_engine_ = std::move(re2);
+        } catch (const std::runtime_error& e) {
+            spdlog::debug("Long lines stay with {}: {}", engine_->name(), e.what());
+        }
+    }
 
-    std::istringstream stream(content);
-    std::string line;
-    int line_number = 0;
+    // FNV-1a over every field that affects what a pattern matches
+    pattern_set_hash_ = 0xcbf29ce484222325ULL;
+    auto feed = [this](const std::string& text) {
+        for (unsigned char c : text) {
+            pattern_set_hash_ ^= c;
+            pattern_set_hash_ *= 0x100000001b3ULL;
+        }
+        pattern_set_hash_ ^= 0xff;  // Field separator
+        pattern_set_hash_ *= 0x100000001b3ULL;
+    };
+    for (const auto& pattern : patterns_) {
+        feed(pattern.name);
+        feed(pattern.regex);
+        feed(pattern.prefilter);
+        feed(std::to_string(pattern.min_entropy));
+        for (const auto& file : pattern.files) {
+            feed(file);
+        }
+    }
 
-    while (std::getline(stream, line)) {
-        line_number++;
+    spdlog::info("Loaded {} patterns ({} engine)", patterns_.size(), engine_->name());
+}
 
-        for (const auto& pattern : patterns_) {
-            // Check if this pattern applies to this file type
-            if (!fileMatchesPattern(filename, pattern.files)) {
-                continue;
-            }
+std::vector<Match> SecretDetector::scanContent(std::string_view content, std::string_view filename,
+                                               ScanContext* context) const {
+    std::vector<Match> matches;
+    std::pmr::vector<MatchSpan> spans =
+        scanBuffer(content, filename, context ? context->memory() : std::pmr::new_delete_resource());
+    matches.reserve(spans.size());
 
-            // Search for pattern in this line
-            std::smatch match;
-            if (std::regex_search(line, match, pattern.regex)) {
-                Match found;
-                found.pattern_name = pattern.name;
-                found.line_number = line_number;
-                found.matched_text = match[0].str();
-                matches.push_back(found);
-            }
+    // Spans arrive in line order, so line numbers are counted incrementally
+    int line_number = 1;
+    size_t counted = 0;
+
+    for (const auto& span : spans) {
+        if (span.offset > counted) {
+            line_number += static_cast<int>(std::count(content.begin() + static_cast<std::ptrdiff_t>(counted),
+                                                       content.begin() + static_cast<std::ptrdiff_t>(span.offset),
+                                                       '\n'));
+            counted = span.offset;
         }
+
+        Match found;
+        found.pattern_index = span.pattern_index;
+        found.line_number = line_number;
+        found.matched_text = std::string(content.substr(span.offset, span.length));
+        found.entropy = span.entropy;
+        found.low_entropy = span.low_entropy;
+        matches.push_back(std::move(found));
     }
 
     return matches;
 }
 
-bool SecretDetector::fileMatchesPattern(const std::string& filename,
-                                        const std::vector<std::string>& file_patterns) {
-    // If pattern applies to all files
-    if (std::find(file_patterns.begin(), file_patterns.end(), "*") != file_patterns.end()) {
-        return true;
+std::pmr::vector<MatchSpan> SecretDetector::scanBuffer(std::string_view content, std::string_view filename,
+                                                       std::pmr::memory_resource* memory) const {
+    static Histogram& file_time = MetricsRegistry::global().histogram(
+        "overwatch_detector_scan_seconds", {}, "Time to scan one file with every applicable pattern");
+    static Histogram& prefilter_time = MetricsRegistry::global().histogram(
+        "overwatch_scan_stage_seconds", {{"stage", "literal_prefilter"}}, "Time per file in each detector stage");
+    static Histogram& engine_time = MetricsRegistry::global().histogram(
+        "overwatch_scan_stage_seconds", {{"stage", "engine_pass"}});
+    static Histogram& entropy_time = MetricsRegistry::global().histogram(
+        "overwatch_scan_stage_seconds", {{"stage", "entropy"}});
+    static Counter& scanned_bytes = MetricsRegistry::global().counter(
+        "overwatch_scanned_bytes_total", {}, "Bytes of file content run through the detector");
+
+    ScopedTimer file_timer(file_time);
+    scanned_bytes.add(content.size());
+    std::pmr::vector<MatchSpan> spans(memory);
+
+    // Patterns that apply to this file type, split by whether a literal anchors them
+    std::pmr::vector<size_t> anchored(memory);
+    std::pmr::vector<size_t> unanchored(memory);
+    for (size_t i : dispatch_.lookup(filename).patterns) {
+        (patterns_[i].literal_id >= 0 ? anchored : unanchored).push_back(i);
+    }
+
+    // One vectorized pass finds every anchor literal in the file
+    LiteralHits literal_hits(memory);
+    if (!anchored.empty()) {
+        ScopedTimer timer(prefilter_time);
+        prefilter_.scan(content, literal_hits);
+    }
+
+    // Anchored patterns are only candidates if their literal occurs; the rest
+    // go through the engine's whole-file pass
+    std::pmr::vector<size_t> candidates(memory);
+    if (!unanchored.empty()) {
+        ScopedTimer timer(engine_time);
+        engine_->matchingPatterns(content, unanchored, candidates);
+    }
+
+    for (size_t index : anchored) {
+        if (!literal_hits[patterns_[index].literal_id].empty()) {
+            candidates.push_back(index);
+        }
+    }
+
+    if (candidates.empty()) {
+        return spans;
     }
 
-    // Check if filename matches any of the patterns
-    for (const auto& pattern : file_patterns) {
-        // Simple wildcard matching: *.ext
-        if (pattern[0] == '*' && pattern.size() > 1) {
-            std::string extension = pattern.substr(1);
-            if (filename.size() >= extension.size() &&
-                filename.substr(filename.size() - extension.size()) == extension) {
+    std::sort(candidates.begin(), candidates.end());
+
+    // Each candidate runs over its own lines so its time can be charged to it;
+    // hits are tagged with their line and rank, then put back in line order
+    struct Located {
+        size_t line_start;
+        size_t rank;
+        MatchSpan span;
+    };
+    std::pmr::vector<Located> located(memory);
+
+    const uint64_t budget = static_cast<uint64_t>(std::max<int64_t>(0, pattern_budget_.count()));
+
+    // Under a budget, lines past kMaxRegexLineLength need a search that can't run away
+    const MatcherEngine* long_engine = nullptr;
+    if (budget != 0) {
+        long_engine = engine_->linearTime() ? engine_.get() : long_line_engine_.get();
+    }
+    auto searchWhole = [&](size_t length) { return budget == 0 || length <= kMaxRegexLineLength || long_engine; };
+
+    for (size_t c = 0; c < candidates.size(); c++) {
+        const Pattern& pattern = patterns_[candidates[c]];
+        const PatternMetrics& metrics = pattern_metrics_[candidates[c]];
+        Stopwatch pattern_watch;
+        size_t found_before = located.size();
+        size_t unchecked = 0;   // Bytes searched since the clock was last read
+        bool over_budget = false;
+        size_t skipped_lines = 0;
+
+        // Search [from, to) of the line starting at line_start; false once the
+        // pattern has used up its budget for this file
+        auto trySpan = [&](size_t line_start, size_t from, size_t to, bool& found) {
+            std::string_view text = content.substr(from, to - from);
+            const MatcherEngine& engine = text.size() > kMaxRegexLineLength && long_engine ? *long_engine : *engine_;
+            size_t start;
+            size_t length;
+            found = engine.find(candidates[c], text, start, length);
+            if (found) {
+                located.push_back({line_start, c, {candidates[c], from + start, length}});
+            }
+
+            if (budget == 0) {
                 return true;
             }
+            unchecked += text.size() + 1;
+            if (unchecked < kBudgetCheckBytes) {
+                return true;
+            }
+            unchecked = 0;
+            over_budget = pattern_watch.elapsed() > budget;
+            return !over_budget;
+        };
+
+        if (pattern.literal_id >= 0) {
+            // Anchored patterns only run on lines that contain their literal
+            const auto& hits = literal_hits[pattern.literal_id];
+            size_t covered = 0;   // Hits up to here have been searched
+            bool any = false;
+            bool found = false;
+            for (size_t h = 0; h < hits.size(); h++) {
+                size_t offset = hits[h];
+                if ((any && offset <= covered) || content[offset] == '\n') {
+                    continue;
+                }
+                size_t line_start = offset == 0 ? 0 : content.rfind('\n', offset - 1) + 1;
+                size_t line_end = content.find('\n', offset);
+                if (line_end == std::string_view::npos) {
+                    line_end = content.size();
+                }
+                any = true;
+
+                if (searchWhole(line_end - line_start)) {
+                    covered = line_end;
+                    if (!trySpan(line_start, line_start, line_end, found)) {
+                        break;
+                    }
+                    continue;
+                }
+
+                // Too long for a backtracking search: every match holds a hit, so
+                // windows around the hits find it; hits whose windows overlap share one
+                size_t from = offset - std::min(offset - line_start, kAnchorWindow);
+                size_t last = offset;
+                while (h + 1 < hits.size() && hits[h + 1] < line_end && hits[h + 1] <= last + 2 * kAnchorWindow &&
+                       hits[h + 1] + kAnchorWindow - from <= kMaxRegexLineLength) {
+                    last = hits[++h];
+                }
+                size_t to = std::min(line_end, last + kAnchorWindow);
+                bool ok = trySpan(line_start, from, to, found);
+                covered = found ? line_end : last;   // As on short lines, the first match per line
+                if (!ok) {
+                    break;
+                }
+            }
+        } else {
+            size_t line_start = 0;
+            bool found = false;
+            while (line_start < content.size()) {
+                size_t line_end = content.find('\n', line_start);
+                if (line_end == std::string_view::npos) {
+                    line_end = content.size();
+                }
+                if (!searchWhole(line_end - line_start)) {
+                    skipped_lines++;
+                } else if (!trySpan(line_start, line_start, line_end, found)) {
+                    break;
+                }
+                line_start = line_end + 1;
+            }
+        }
+
+        metrics.time->record(pattern_watch.elapsed());
+        metrics.matches->add(located.size() - found_before);
+        if (over_budget) {
+            spdlog::warn("Pattern '{}' exceeded its {} budget on {}, skipped the rest of the file",
+                         pattern.name, formatDuration(budget), filename);
+        } else if (skipped_lines > 0) {
+            spdlog::warn("Pattern '{}' skipped {} lines of {} longer than {} bytes ({} can't bound them)",
+                         pattern.name, skipped_lines, filename, kMaxRegexLineLength, engine_->name());
         }
-        // Exact filename match
-        else if (filename == pattern) {
-            return true;
+        if (over_budget || skipped_lines > 0) {
+            metrics.over_budget->add();
         }
     }
 
-    return false;
+    // Report matches in pattern order within each line, as before
+    std::sort(located.begin(), located.end(), [](const Located& a, const Located& b) {
+        return a.line_start != b.line_start ? a.line_start < b.line_start : a.rank < b.rank;
+    });
+    spans.reserve(located.size());
+    for (const auto& hit : located) {
+        spans.push_back(hit.span);
+    }
+
+    // Score what each match captured; only a pattern with a min_entropy flags any
+    ScopedTimer timer(entropy_time);
+    for (auto& span : spans) {
+        const Pattern& pattern = patterns_[span.pattern_index];
+        EntropyScore score = scoreEntropy(secretValue(content.substr(span.offset, span.length)));
+        span.entropy = score.entropy;
+
+        if (score.entropy < pattern.min_entropy) {
+            span.low_entropy = true;
+            pattern_metrics_[span.pattern_index].low_entropy->add();
+            spdlog::debug("{} match in {} scores {:.2f} bits/char over {} character classes, under {:.2f}",
+                          pattern.name, filename, score.entropy, score.classes(), pattern.min_entropy);
+        }
+    }
+
+    return spans;
+}
+
+std::vector<PatternCost> SecretDetector::patternCosts() const {
+    std::vector<PatternCost> costs;
+    costs.reserve(patterns_.size());
+
+    for (size_t i = 0; i < patterns_.size(); i++) {
+        const PatternMetrics& metrics = pattern_metrics_[i];
+        PatternCost cost;
+        cost.name = patterns_[i].name;
+        cost.files = metrics.time->count();
+        cost.matches = metrics.matches->value();
+        cost.total_nanos = metrics.time->sum();
+        cost.p99_nanos = metrics.time->quantile(0.99);
+        cost.max_nanos = metrics.time->max();
+        cost.over_budget = metrics.over_budget->value();
+        cost.low_entropy = metrics.low_entropy->value();
+        costs.push_back(cost);
+    }
+
+    return costs;
+}
+
+int SecretDetector::lineNumberAt(std::string_view content, size_t offset) {
+    offset = std::min(offset, content.size());
+    return 1 + static_cast<int>(std::count(content.begin(), content.begin() + static_cast<std::ptrdiff_t>(offset), '\n'));
+}
+
+bool SecretDetector::isTargetedFile(const std::string& filename) const {
+    return dispatch_.lookup(filename).targeted;
 }
 
-} 
\ No newline at end of file
+}
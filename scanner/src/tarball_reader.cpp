@@ -0,0 +1,308 @@
+#include "tarball_reader.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+
+namespace overwatch {
+
+namespace {
+
+constexpr size_t kBlockSize = 512;
+
+// Inflated bytes produced per zlib call
+constexpr size_t kInflateChunk = 64 * 1024;
+
+// pax headers larger than this are skipped rather than buffered
+constexpr size_t kMaxMetadataSize = 1024 * 1024;
+
+std::string field(const char* data, size_t length) {
+    return std::string(data, strnlen(data, length));
+}
+
+// Octal number (optionally space/NUL terminated), or GNU base-256 for large values
+bool parseNumber(const unsigned char* data, size_t length, uint64_t& value) {
+    value = 0;
+    if (data[0] & 0x80) {
+        for (size_t i = 1; i < length; i++) {
+            value = (value << 8) | data[i];
+        }
+        return true;
+    }
+
+    size_t i = 0;
+    while (i < length && data[i] == ' ') {
+        i++;
+    }
+    bool digits = false;
+    for (; i < length && data[i] >= '0' && data[i] <= '7'; i++) {
+        value = (value << 3) | static_cast<uint64_t>(data[i] - '0');
+        digits = true;
+    }
+    return digits && (i == length || data[i] == ' ' || data[i] == '\0');
+}
+
+} // namespace
+
+TarballReader::TarballReader(EntryFilter filter, EntryHandler handler, size_t max_entry_size)
+    : filter_(std::move(filter)),
+      handler_(std::move(handler)),
+      max_entry_size_(max_entry_size),
+      stream_(std::make_unique<z_stream_s>()) {
+    std::memset(stream_.get(), 0, sizeof(z_stream_s));
+
+    // 15 + 32: largest window, detect gzip or zlib framing from the header
+    if (inflateInit2(stream_.get(), 15 + 32) != Z_OK) {
+        stream_.reset();
+        fail("could not initialise zlib");
+    }
+    header_.reserve(kBlockSize);
+}
+
+TarballReader::~TarballReader() {
+    if (stream_) {
+        inflateEnd(stream_.get());
+    }
+}
+
+bool TarballReader::feed(const char* data, size_t size) {
+    if (stopped_) {
+        return false;
+    }
+    if (inflate_done_ || state_ == State::END) {
+        return true;  // Trailing bytes after the archive
+    }
+
+    char out[kInflateChunk];
+    stream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream_->avail_in = static_cast<uInt>(size);
+
+    while (!stopped_) {
+        stream_->next_out = reinterpret_cast<Bytef*>(out);
+        stream_->avail_out = static_cast<uInt>(sizeof(out));
+
+        int ret = inflate(stream_.get(), Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            return fail(std::string("gzip: ") + (stream_->msg ? stream_->msg : "corrupt stream"));
+        }
+
+        size_t produced = sizeof(out) - stream_->avail_out;
+        if (produced > 0 && !consume(out, produced)) {
+            return false;
+        }
+
+        if (ret == Z_STREAM_END) {
+            inflate_done_ = true;
+            break;
+        }
+
+        // Input used up and nothing held back in zlib's window
+        if (stream_->avail_in == 0 && stream_->avail_out != 0) {
+            break;
+        }
+        if (ret == Z_BUF_ERROR && produced == 0) {
+            break;
+        }
+    }
+
+    return !stopped_;
+}
+
+bool TarballReader::finish() const {
+    if (!error_.empty() || stopped_) {
+        return false;
+    }
+    // Some writers omit the two zero blocks; a clean gzip end on a block boundary is enough
+    return state_ == State::END || (inflate_done_ && state_ == State::HEADER && header_.empty());
+}
+
+bool TarballReader::consume(const char* data, size_t size) {
+    while (size > 0 && !stopped_) {
+        switch (state_) {
+        case State::HEADER: {
+            size_t n = std::min(kBlockSize - header_.size(), size);
+            header_.append(data, n);
+            data += n;
+            size -= n;
+            if (header_.size() == kBlockSize) {
+                bool ok = parseHeader();
+                header_.clear();
+                if (!ok) {
+                    return false;
+                }
+            }
+            break;
+        }
+
+        case State::DATA: {
+            size_t n = std::min(remaining_, size);
+            if (body_ != Body::SKIP) {
+                content_.append(data, n);
+            }
+            data += n;
+            size -= n;
+            remaining_ -= n;
+            if (remaining_ == 0 && !endEntry()) {
+                return false;
+            }
+            break;
+        }
+
+        case State::PADDING: {
+            size_t n = std::min(padding_, size);
+            data += n;
+            size -= n;
+            padding_ -= n;
+            if (padding_ == 0) {
+                state_ = State::HEADER;
+            }
+            break;
+        }
+
+        case State::END:
+            return true;
+        }
+    }
+
+    return !stopped_;
+}
+
+bool TarballReader::parseHeader() {
+    const auto* block = reinterpret_cast<const unsigned char*>(header_.data());
+
+    if (std::all_of(block, block + kBlockSize, [](unsigned char c) { return c == 0; })) {
+        if (++zero_blocks_ >= 2) {
+            state_ = State::END;
+        }
+        return true;
+    }
+    zero_blocks_ = 0;
+
+    // Checksum: byte sum of the header with the checksum field read as spaces
+    uint64_t expected;
+    if (!parseNumber(block + 148, 8, expected)) {
+        return fail("tar: bad header checksum field");
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kBlockSize; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : block[i];
+    }
+    if (sum != expected) {
+        return fail("tar: header checksum mismatch");
+    }
+
+    uint64_t size;
+    if (!parseNumber(block + 124, 12, size)) {
+        return fail("tar: bad entry size");
+    }
+
+    const char* raw = header_.data();
+    std::string name = field(raw, 100);
+    if (std::memcmp(raw + 257, "ustar", 5) == 0) {
+        std::string prefix = field(raw + 345, 155);
+        if (!prefix.empty()) {
+            name = prefix + "/" + name;
+        }
+    }
+
+    char type = raw[156];
+    remaining_ = static_cast<size_t>(size);
+    padding_ = (kBlockSize - remaining_ % kBlockSize) % kBlockSize;
+    content_.clear();
+    body_ = Body::SKIP;
+
+    if (type == 'x') {
+        body_ = remaining_ <= kMaxMetadataSize ? Body::PAX : Body::SKIP;
+    } else if (type == 'L') {
+        body_ = remaining_ <= kMaxMetadataSize ? Body::LONG_NAME : Body::SKIP;
+    } else if (type == 'g') {
+        // Global pax header (GitHub stores the commit SHA here) - nothing we need
+    } else {
+        if (!next_path_.empty()) {
+            name = std::move(next_path_);
+            next_path_.clear();
+        }
+
+        if (type == '0' || type == '\0' || type == '7') {
+            entries_++;
+
+            // Drop the "<owner>-<repo>-<sha>/" wrapper directory
+            size_t slash = name.find('/');
+            path_ = slash == std::string::npos ? std::string() : name.substr(slash + 1);
+
+            if (!path_.empty() && remaining_ <= max_entry_size_ && filter_(path_, remaining_)) {
+                body_ = Body::FILE;
+                content_.reserve(remaining_);
+            }
+        }
+    }
+
+    if (remaining_ == 0) {
+        return endEntry();
+    }
+    state_ = State::DATA;
+    return true;
+}
+
+bool TarballReader::endEntry() {
+    switch (body_) {
+    case Body::FILE:
+        if (!handler_(path_, std::move(content_))) {
+            stopped_ = true;
+        }
+        break;
+    case Body::PAX:
+        parsePax(content_);
+        break;
+    case Body::LONG_NAME:
+        next_path_ = field(content_.data(), content_.size());
+        break;
+    case Body::SKIP:
+        break;
+    }
+
+    content_.clear();
+    body_ = Body::SKIP;
+    state_ = padding_ > 0 ? State::PADDING : State::HEADER;
+    return !stopped_;
+}
+
+void TarballReader::parsePax(const std::string& records) {
+    // Records are "<length> <key>=<value>\n", the length covering the whole record
+    size_t pos = 0;
+    while (pos < records.size()) {
+        size_t space = records.find(' ', pos);
+        if (space == std::string::npos) {
+            return;
+        }
+
+        size_t length = 0;
+        for (size_t i = pos; i < space; i++) {
+            if (records[i] < '0' || records[i] > '9') {
+                return;
+            }
+            length = length * 10 + static_cast<size_t>(records[i] - '0');
+        }
+        if (length <= space - pos || pos + length > records.size()) {
+            return;
+        }
+
+        std::string record = records.substr(space + 1, pos + length - space - 1);
+        if (!record.empty() && record.back() == '\n') {
+            record.pop_back();
+        }
+        size_t equals = record.find('=');
+        if (equals != std::string::npos && record.compare(0, equals, "path") == 0) {
+            next_path_ = record.substr(equals + 1);
+        }
+
+        pos += length;
+    }
+}
+
+bool TarballReader::fail(const std::string& message) {
+    error_ = message;
+    stopped_ = true;
+    return false;
+}
+
+} // namespace overwatch
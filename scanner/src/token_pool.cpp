@@ -0,0 +1,97 @@
+#include "token_pool.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace overwatch {
+
+TokenPool::TokenPool(const std::vector<std::string>& tokens) {
+    for (const auto& token : tokens) {
+        auto state = std::make_unique<TokenState>();
+        state->token = token;
+        state->label = token.substr(0, std::min<size_t>(token.size(), 6)) + "...";
+        tokens_.push_back(std::move(state));
+    }
+
+    // Unauthenticated access still needs one (empty) slot
+    if (tokens_.empty()) {
+        auto state = std::make_unique<TokenState>();
+        state->label = "unauthenticated";
+        tokens_.push_back(std::move(state));
+    }
+}
+
+std::vector<std::string> TokenPool::loadFromEnvironment() {
+    std::vector<std::string> tokens;
+
+    auto add = [&tokens](const std::string& token) {
+        if (!token.empty() && std::find(tokens.begin(), tokens.end(), token) == tokens.end()) {
+            tokens.push_back(token);
+        }
+    };
+
+    // GITHUB_TOKENS="ghp_a,ghp_b ghp_c"
+    if (const char* list = std::getenv("GITHUB_TOKENS")) {
+        std::string value = list;
+        std::replace(value.begin(), value.end(), ',', ' ');
+        std::istringstream stream(value);
+        std::string token;
+        while (stream >> token) {
+            add(token);
+        }
+    }
+
+    // GITHUB_TOKENS_FILE=/path/to/tokens.txt
+    if (const char* path = std::getenv("GITHUB_TOKENS_FILE")) {
+        std::ifstream infile(path);
+        if (!infile) {
+            spdlog::warn("Could not read GITHUB_TOKENS_FILE: {}", path);
+        }
+
+        std::string line;
+        while (std::getline(infile, line)) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream stream(line);
+            std::string token;
+            if (stream >> token) {
+                add(token);
+            }
+        }
+    }
+
+    if (const char* token = std::getenv("GITHUB_TOKEN")) {
+        add(token);
+    }
+
+    return tokens;
+}
+
+TokenState& TokenPool::select(RateResource resource) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t best = next_ % tokens_.size();
+    double best_headroom = tokens_[best]->limiter.headroom(resource);
+
+    for (size_t i = 1; i < tokens_.size(); i++) {
+        size_t index = (next_ + i) % tokens_.size();
+        double headroom = tokens_[index]->limiter.headroom(resource);
+        if (headroom > best_headroom) {
+            best = index;
+            best_headroom = headroom;
+        }
+    }
+
+    next_ = best + 1;
+    return *tokens_[best];
+}
+
+void TokenPool::remove(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < tokens_.size()) {
+        tokens_.erase(tokens_.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+}
+
+} // namespace overwatch